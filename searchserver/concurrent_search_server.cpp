@@ -0,0 +1,250 @@
+#include "concurrent_search_server.h"
+
+#include <iterator>
+
+using namespace std;
+
+ConcurrentSearchServer::ConcurrentSearchServer(const string& stop_words_text)
+    : ConcurrentSearchServer(SplitIntoWords(stop_words_text))
+{
+}
+
+ConcurrentSearchServer::~ConcurrentSearchServer() {
+    {
+        lock_guard lock(merge_signal_mutex_);
+        stopping_ = true;
+    }
+    merge_signal_.notify_one();
+    merge_thread_.join();
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    auto index = make_shared<SearchServer>(stop_words_);
+    index->AddDocument(document_id, document, status, ratings);
+    AddSegment(move(index));
+}
+
+void ConcurrentSearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    auto index = make_shared<SearchServer>(stop_words_);
+    index->AddDocuments(documents);
+    AddSegment(move(index));
+}
+
+void ConcurrentSearchServer::AddSegment(shared_ptr<const SearchServer> index) {
+    if (index->GetDocumentCount() == 0) {
+        return;
+    }
+    {
+        lock_guard lock(write_mutex_);
+        const auto snapshot = GetSnapshot();
+        for (const auto& document : index->GetRawDocuments()) {
+            if (HasDocument(*snapshot, document.id)) {
+                throw invalid_argument("Invalid document_id"s);
+            }
+        }
+        auto segments = snapshot->segments;
+        segments.push_back({move(index), {}, nullptr});
+        Publish(move(segments));
+    }
+    RequestMerge();
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    {
+        lock_guard lock(write_mutex_);
+        auto segments = GetSnapshot()->segments;
+        const auto it = find_if(segments.begin(), segments.end(), [document_id](const Segment& segment) {
+            return segment.index->HasDocument(document_id) && !segment.IsRemoved(document_id);
+        });
+        if (it == segments.end()) {
+            return;
+        }
+        it->tombstones.insert(upper_bound(it->tombstones.begin(), it->tombstones.end(), document_id), document_id);
+        auto removed = it->removed ? make_shared<RemovedStatistics>(*it->removed) : make_shared<RemovedStatistics>();
+        removed->AddDocument(*it->index, document_id);
+        it->removed = move(removed);
+        Publish(move(segments));
+    }
+    RequestMerge();
+}
+
+void ConcurrentSearchServer::MergeSegments() {
+    while (MergeOnce()) {
+    }
+}
+
+void ConcurrentSearchServer::SetRankingModel(RankingModel model) {
+    lock_guard lock(write_mutex_);
+    Publish(GetSnapshot()->segments, model);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsInSegments(raw_query, status, top_k);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string>, DocumentStatus> ConcurrentSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    const auto snapshot = GetSnapshot();
+    for (const auto& segment : snapshot->segments) {
+        if (segment.index->HasDocument(document_id) && !segment.IsRemoved(document_id)) {
+            const auto [words, status] = segment.index->MatchDocument(raw_query, document_id);
+            return {vector<string>(words.begin(), words.end()), status};
+        }
+    }
+    throw out_of_range("Invalid document_id"s);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const auto& segment : GetSnapshot()->segments) {
+        document_count += segment.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ConcurrentSearchServer::GetSegmentCount() const {
+    return GetSnapshot()->segments.size();
+}
+
+shared_ptr<const ConcurrentSearchServer::Snapshot> ConcurrentSearchServer::GetSnapshot() const {
+    return atomic_load(&snapshot_);
+}
+
+void ConcurrentSearchServer::Publish(vector<Segment> segments) {
+    Publish(move(segments), GetSnapshot()->ranking_model);
+}
+
+void ConcurrentSearchServer::Publish(vector<Segment> segments, RankingModel ranking_model) {
+    atomic_store(&snapshot_, shared_ptr<const Snapshot>(make_shared<Snapshot>(Snapshot{move(segments), ranking_model})));
+}
+
+bool ConcurrentSearchServer::HasDocument(const Snapshot& snapshot, int document_id) {
+    return any_of(snapshot.segments.begin(), snapshot.segments.end(), [document_id](const Segment& segment) {
+        return segment.index->HasDocument(document_id) && !segment.IsRemoved(document_id);
+    });
+}
+
+CorpusStatistics ConcurrentSearchServer::CollectStatistics(const Snapshot& snapshot, string_view raw_query) {
+    CorpusStatistics statistics;
+    for (const auto& segment : snapshot.segments) {
+        segment.index->CollectStatistics(raw_query, statistics);
+        if (!segment.removed) {
+            continue;
+        }
+        statistics.document_count -= static_cast<int>(segment.tombstones.size());
+        statistics.word_count -= segment.removed->word_count;
+        for (auto& [word, document_freq] : statistics.document_freqs) {
+            if (const auto it = segment.removed->document_freqs.find(word); it != segment.removed->document_freqs.end()) {
+                document_freq -= it->second;
+            }
+        }
+    }
+    return statistics;
+}
+
+void ConcurrentSearchServer::RemovedStatistics::AddDocument(const SearchServer& index, int document_id) {
+    word_count += index.GetDocumentLength(document_id);
+    for (const auto [word, term_freq] : index.GetWordFrequencies(document_id)) {
+        ++document_freqs[word];
+    }
+}
+
+void ConcurrentSearchServer::RequestMerge() {
+    {
+        lock_guard lock(merge_signal_mutex_);
+        merge_requested_ = true;
+    }
+    merge_signal_.notify_one();
+}
+
+void ConcurrentSearchServer::RunMerges() {
+    unique_lock lock(merge_signal_mutex_);
+    while (true) {
+        merge_signal_.wait(lock, [this] {
+            return merge_requested_ || stopping_;
+        });
+        if (stopping_) {
+            return;
+        }
+        merge_requested_ = false;
+        lock.unlock();
+        while (MergeOnce()) {
+            if (lock_guard stop_lock(merge_signal_mutex_); stopping_) {
+                break;
+            }
+        }
+        lock.lock();
+    }
+}
+
+bool ConcurrentSearchServer::MergeOnce() {
+    lock_guard merge_lock(merge_mutex_);
+    const auto snapshot = GetSnapshot();
+
+    // A segment full of tombstones is rewritten alone, otherwise the smallest segments are merged
+    vector<const Segment*> sources;
+    for (const auto& segment : snapshot->segments) {
+        if (!segment.tombstones.empty()
+            && static_cast<int>(segment.tombstones.size()) * MAX_TOMBSTONE_SHARE > segment.index->GetDocumentCount()) {
+            sources.push_back(&segment);
+            break;
+        }
+    }
+    if (sources.empty() && snapshot->segments.size() > MAX_SEGMENT_COUNT) {
+        for (const auto& segment : snapshot->segments) {
+            sources.push_back(&segment);
+        }
+        partial_sort(sources.begin(), sources.begin() + MERGE_FACTOR, sources.end(), [](const Segment* lhs, const Segment* rhs) {
+            return lhs->GetDocumentCount() < rhs->GetDocumentCount();
+        });
+        sources.resize(MERGE_FACTOR);
+    }
+    if (sources.empty()) {
+        return false;
+    }
+
+    // The merged segment is built without blocking writers
+    vector<RawDocument> documents;
+    for (const auto* segment : sources) {
+        for (auto& document : segment->index->GetRawDocuments()) {
+            if (!segment->IsRemoved(document.id)) {
+                documents.push_back(move(document));
+            }
+        }
+    }
+    auto merged = make_shared<SearchServer>(stop_words_);
+    merged->AddDocuments(documents);
+
+    lock_guard write_lock(write_mutex_);
+    vector<Segment> segments;
+    Segment merged_segment{move(merged), {}, nullptr};
+    for (const auto& segment : GetSnapshot()->segments) {
+        const auto source = find_if(sources.begin(), sources.end(), [&segment](const Segment* source) {
+            return source->index == segment.index;
+        });
+        if (source == sources.end()) {
+            segments.push_back(segment);
+            continue;
+        }
+        // Documents removed during the merge stay removed
+        set_difference(segment.tombstones.begin(), segment.tombstones.end(),
+                       (*source)->tombstones.begin(), (*source)->tombstones.end(),
+                       back_inserter(merged_segment.tombstones));
+    }
+    sort(merged_segment.tombstones.begin(), merged_segment.tombstones.end());
+    if (!merged_segment.tombstones.empty()) {
+        auto removed = make_shared<RemovedStatistics>();
+        for (const int document_id : merged_segment.tombstones) {
+            removed->AddDocument(*merged_segment.index, document_id);
+        }
+        merged_segment.removed = move(removed);
+    }
+    if (merged_segment.GetDocumentCount() > 0) {
+        segments.push_back(move(merged_segment));
+    }
+    Publish(move(segments));
+    return true;
+}
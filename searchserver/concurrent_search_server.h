@@ -0,0 +1,175 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Search server answering queries while documents are added and removed.
+// The index is a list of immutable segments published as a snapshot: writers
+// atomically replace the snapshot, queries work with the snapshot taken at their
+// start, which stays alive until they finish. Modifications are serialized,
+// queries never wait for them.
+// Every addition becomes a new segment and a removal only marks the document
+// in the tombstones of its segment, so both cost O(document). A background
+// thread merges small segments and rewrites segments with many removed
+// documents, which keeps the number of segments and tombstones bounded
+class ConcurrentSearchServer {
+public:
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words)
+        : stop_words_(stop_words.begin(), stop_words.end())
+        , snapshot_(std::make_shared<const Snapshot>())
+    {
+        // Validates the stop words
+        SearchServer{stop_words_};
+        merge_thread_ = std::thread(&ConcurrentSearchServer::RunMerges, this);
+    }
+
+    explicit ConcurrentSearchServer(const std::string& stop_words_text);
+
+    ConcurrentSearchServer(const ConcurrentSearchServer&) = delete;
+    ConcurrentSearchServer& operator=(const ConcurrentSearchServer&) = delete;
+
+    ~ConcurrentSearchServer();
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // The batch becomes a single segment
+    void AddDocuments(const std::vector<RawDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Merges segments in the calling thread until the merge policy is satisfied
+    void MergeSegments();
+
+    // TF-IDF unless changed. The model is a part of the snapshot passed to the segments by queries,
+    // so the change publishes the same segments with the new model
+    void SetRankingModel(RankingModel model);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsInSegments(raw_query, document_predicate, top_k);
+    }
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Words are copied: the segment they would point to may be dropped by a writer
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetSegmentCount() const;
+
+private:
+    // Totals of the removed documents of a segment. Queries subtract them from the statistics
+    // of the segment, so their cost doesn't depend on the number of removed documents
+    struct RemovedStatistics {
+        int64_t word_count = 0;
+        // Keys are words of the segment's dictionary
+        std::unordered_map<std::string_view, int> document_freqs;
+
+        void AddDocument(const SearchServer& index, int document_id);
+    };
+
+    struct Segment {
+        std::shared_ptr<const SearchServer> index;
+        // Removed documents, sorted. Segments are immutable, a removal makes a new list
+        std::vector<int> tombstones;
+        // Null while there are no tombstones, replaced together with them
+        std::shared_ptr<const RemovedStatistics> removed;
+
+        bool IsRemoved(int document_id) const {
+            return std::binary_search(tombstones.begin(), tombstones.end(), document_id);
+        }
+
+        int GetDocumentCount() const {
+            return index->GetDocumentCount() - static_cast<int>(tombstones.size());
+        }
+    };
+
+    struct Snapshot {
+        std::vector<Segment> segments;
+        RankingModel ranking_model = RankingModel::TF_IDF;
+    };
+
+    // More segments than this are merged, MERGE_FACTOR smallest at a time
+    static const size_t MAX_SEGMENT_COUNT = 16;
+    static const size_t MERGE_FACTOR = 8;
+    // A segment with more removed documents than this part of all of them is rewritten
+    static const int MAX_TOMBSTONE_SHARE = 8;
+
+    const std::vector<std::string> stop_words_;
+    // Read and replaced with the atomic shared_ptr functions
+    std::shared_ptr<const Snapshot> snapshot_;
+    std::mutex write_mutex_;
+    // Only one merge runs at a time, so merged segments can't disappear meanwhile
+    std::mutex merge_mutex_;
+
+    std::mutex merge_signal_mutex_;
+    std::condition_variable merge_signal_;
+    bool merge_requested_ = false;
+    bool stopping_ = false;
+    std::thread merge_thread_;
+
+    // The filter is a predicate or a status, which segments without removed documents
+    // check with their status bitmaps
+    template <typename DocumentFilter>
+    std::vector<Document> FindTopDocumentsInSegments(std::string_view raw_query, DocumentFilter document_filter, size_t top_k) const {
+        const auto snapshot = GetSnapshot();
+        const auto statistics = CollectStatistics(*snapshot, raw_query);
+
+        std::vector<std::vector<Document>> segment_documents(snapshot->segments.size());
+        std::transform(std::execution::par, snapshot->segments.begin(), snapshot->segments.end(), segment_documents.begin(),
+            [&](const Segment& segment) {
+                if (segment.tombstones.empty()) {
+                    return segment.index->FindTopDocuments(raw_query, document_filter, top_k, statistics, snapshot->ranking_model);
+                }
+                return segment.index->FindTopDocuments(raw_query,
+                    [&](int document_id, DocumentStatus status, int rating) {
+                        if (segment.IsRemoved(document_id)) {
+                            return false;
+                        }
+                        if constexpr (std::is_same_v<DocumentFilter, DocumentStatus>) {
+                            return status == document_filter;
+                        } else {
+                            return document_filter(document_id, status, rating);
+                        }
+                    }, top_k, statistics, snapshot->ranking_model);
+            });
+
+        std::vector<Document> matched_documents;
+        for (const auto& documents : segment_documents) {
+            matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+        }
+        SelectTopDocuments(matched_documents, top_k);
+        return matched_documents;
+    }
+
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+    // Keeps the ranking model of the current snapshot
+    void Publish(std::vector<Segment> segments);
+    void Publish(std::vector<Segment> segments, RankingModel ranking_model);
+    void AddSegment(std::shared_ptr<const SearchServer> index);
+    static bool HasDocument(const Snapshot& snapshot, int document_id);
+    // Statistics of the documents that aren't removed
+    static CorpusStatistics CollectStatistics(const Snapshot& snapshot, std::string_view raw_query);
+
+    void RequestMerge();
+    void RunMerges();
+    // Returns false if there is nothing to merge
+    bool MergeOnce();
+};
@@ -1,5 +1,8 @@
 #include "document.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 
 
@@ -16,4 +19,22 @@ ostream& operator<<(ostream& out, const Document& document) {
         << "relevance = "s << document.relevance << ", "s
         << "rating = "s << document.rating << " }"s;
     return out;
+}
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON) {
+        // Ids make the order deterministic, whatever order documents were scored in
+        return lhs.rating > rhs.rating || (lhs.rating == rhs.rating && lhs.id < rhs.id);
+    } else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+void SelectTopDocuments(vector<Document>& documents, size_t top_k) {
+    if (documents.size() > top_k) {
+        partial_sort(documents.begin(), documents.begin() + top_k, documents.end(), IsMoreRelevant);
+        documents.resize(top_k);
+    } else {
+        sort(documents.begin(), documents.end(), IsMoreRelevant);
+    }
 }
\ No newline at end of file
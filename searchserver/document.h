@@ -1,5 +1,10 @@
 #pragma once
 #include <ostream>
+#include <vector>
+
+// Relevances closer than this are treated as equal and ordered by rating
+const double RELEVANCE_EPSILON = 1e-6;
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
@@ -17,4 +22,12 @@ struct Document {
     int rating = 0;
 };
 
-std::ostream& operator<<(std::ostream& out, const Document& document);
\ No newline at end of file
+std::ostream& operator<<(std::ostream& out, const Document& document);
+
+// Ranking order of search results: higher relevance first, equal relevance by higher rating,
+// then by lower id
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Leaves the top_k best documents in ranking order.
+// Uses a bounded heap, so the cost is O(N log top_k) rather than a full sort
+void SelectTopDocuments(std::vector<Document>& documents, size_t top_k);
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "document_store.h"
+
+#include <algorithm>
+
+using namespace std;
+
+DocumentStore::Leaf::Leaf() {
+    fill(begin(ordinals), end(ordinals), NO_ORDINAL);
+}
+
+void DocumentStore::Add(int document_id, DocumentStatus status, int rating, int word_count, string_view text) {
+    Remove(document_id);
+    const size_t node_index = static_cast<size_t>(document_id) >> (LEAF_BITS + NODE_BITS);
+    if (node_index >= nodes_.size()) {
+        nodes_.resize(node_index + 1);
+    }
+    if (!nodes_[node_index]) {
+        nodes_[node_index] = make_unique<Node>();
+    }
+    auto& leaf = nodes_[node_index]->leaves[(document_id >> LEAF_BITS) & NODE_MASK];
+    if (!leaf) {
+        leaf = make_unique<Leaf>();
+    }
+
+    uint32_t ordinal;
+    if (free_ordinals_.empty()) {
+        ordinal = static_cast<uint32_t>(ratings_.size());
+        ratings_.push_back(rating);
+        word_counts_.push_back(word_count);
+        texts_.push_back(text);
+        statuses_.push_back(static_cast<uint8_t>(status));
+        if (ordinal % 64 == 0) {
+            for (auto& bits : status_bits_) {
+                bits.push_back(0);
+            }
+        }
+    } else {
+        ordinal = free_ordinals_.back();
+        free_ordinals_.pop_back();
+        ratings_[ordinal] = rating;
+        word_counts_[ordinal] = word_count;
+        texts_[ordinal] = text;
+        statuses_[ordinal] = static_cast<uint8_t>(status);
+    }
+    status_bits_[static_cast<int>(status)][ordinal >> 6] |= uint64_t{1} << (ordinal & 63);
+    leaf->ordinals[document_id & LEAF_MASK] = ordinal;
+}
+
+// The leaf stays allocated for the other documents of its id range
+void DocumentStore::Remove(int document_id) {
+    const uint32_t ordinal = FindOrdinal(document_id);
+    if (ordinal == NO_ORDINAL) {
+        return;
+    }
+    nodes_[document_id >> (LEAF_BITS + NODE_BITS)]->leaves[(document_id >> LEAF_BITS) & NODE_MASK]
+        ->ordinals[document_id & LEAF_MASK] = NO_ORDINAL;
+    status_bits_[statuses_[ordinal]][ordinal >> 6] &= ~(uint64_t{1} << (ordinal & 63));
+    texts_[ordinal] = {};
+    free_ordinals_.push_back(ordinal);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Metadata of the indexed documents. Every document gets a dense internal ordinal,
+// the fields are columns indexed by ordinals, so reading a field is an array access.
+// Every status has a bitmap of ordinals: a filter by status tests a single bit.
+// Ordinals are found by a two-level table of ids with lazily allocated leaves,
+// so memory is about 30 bytes per document plus a 1 KB leaf per range of 256 ids
+// holding some document, however sparse the ids are. Ordinals of removed documents are reused
+class DocumentStore {
+public:
+    // word_count is the number of indexed words of the document
+    void Add(int document_id, DocumentStatus status, int rating, int word_count, std::string_view text);
+
+    void Remove(int document_id);
+
+    bool Contains(int document_id) const {
+        return FindOrdinal(document_id) != NO_ORDINAL;
+    }
+
+    bool HasStatus(int document_id, DocumentStatus status) const {
+        const uint32_t ordinal = FindOrdinal(document_id);
+        return ordinal != NO_ORDINAL && TestBit(status_bits_[static_cast<int>(status)], ordinal);
+    }
+
+    // The getters expect a stored document
+    DocumentStatus GetStatus(int document_id) const {
+        return static_cast<DocumentStatus>(statuses_[GetOrdinal(document_id)]);
+    }
+
+    int GetRating(int document_id) const {
+        return ratings_[GetOrdinal(document_id)];
+    }
+
+    int GetWordCount(int document_id) const {
+        return word_counts_[GetOrdinal(document_id)];
+    }
+
+    double GetInvWordCount(int document_id) const {
+        return 1.0 / word_counts_[GetOrdinal(document_id)];
+    }
+
+    std::string_view GetText(int document_id) const {
+        return texts_[GetOrdinal(document_id)];
+    }
+
+    size_t size() const {
+        return ratings_.size() - free_ordinals_.size();
+    }
+
+private:
+    static constexpr uint32_t NO_ORDINAL = UINT32_MAX;
+    static const int LEAF_BITS = 8;
+    static const int LEAF_SIZE = 1 << LEAF_BITS;
+    static const int LEAF_MASK = LEAF_SIZE - 1;
+    static const int NODE_BITS = 8;
+    static const int NODE_SIZE = 1 << NODE_BITS;
+    static const int NODE_MASK = NODE_SIZE - 1;
+    static const int STATUS_COUNT = static_cast<int>(DocumentStatus::REMOVED) + 1;
+
+    // Ordinals of LEAF_SIZE consecutive ids
+    struct Leaf {
+        uint32_t ordinals[LEAF_SIZE];
+
+        Leaf();
+    };
+
+    // Leaves of NODE_SIZE consecutive leaf ranges
+    struct Node {
+        std::unique_ptr<Leaf> leaves[NODE_SIZE];
+    };
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+
+    std::vector<int> ratings_;
+    std::vector<int> word_counts_;
+    std::vector<std::string_view> texts_;
+    std::vector<uint8_t> statuses_;
+    std::vector<uint64_t> status_bits_[STATUS_COUNT];
+    std::vector<uint32_t> free_ordinals_;
+
+    uint32_t FindOrdinal(int document_id) const {
+        const size_t node = static_cast<size_t>(document_id) >> (LEAF_BITS + NODE_BITS);
+        if (document_id < 0 || node >= nodes_.size() || !nodes_[node]) {
+            return NO_ORDINAL;
+        }
+        const Leaf* leaf = nodes_[node]->leaves[(document_id >> LEAF_BITS) & NODE_MASK].get();
+        return leaf != nullptr ? leaf->ordinals[document_id & LEAF_MASK] : NO_ORDINAL;
+    }
+
+    uint32_t GetOrdinal(int document_id) const {
+        return nodes_[document_id >> (LEAF_BITS + NODE_BITS)]->leaves[(document_id >> LEAF_BITS) & NODE_MASK]
+            ->ordinals[document_id & LEAF_MASK];
+    }
+
+    static bool TestBit(const std::vector<uint64_t>& words, uint32_t bit) {
+        return (words[bit >> 6] >> (bit & 63)) & 1;
+    }
+};
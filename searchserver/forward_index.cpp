@@ -0,0 +1,104 @@
+#include "forward_index.h"
+
+#include <algorithm>
+
+using namespace std;
+
+bool ForwardIndex::Document::Contains(InvertedIndex::TermId term) const {
+    const Entry* it = lower_bound(begin, end, term, [](const Entry& entry, InvertedIndex::TermId term) {
+        return entry.term < term;
+    });
+    return it != end && it->term == term;
+}
+
+void ForwardIndex::AddDocument(int document_id, const Entry* entries, size_t entry_count) {
+    RemoveDocument(document_id);
+    Detach();
+    documents_[document_id] = {entries_.size(), entry_count};
+    entries_.insert(entries_.end(), entries, entries + entry_count);
+}
+
+void ForwardIndex::RemoveDocument(int document_id) {
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return;
+    }
+    removed_entry_count_ += it->second.size;
+    documents_.erase(it);
+    if (removed_entry_count_ * 2 > GetEntryCount()) {
+        Compact();
+    }
+}
+
+void ForwardIndex::Reserve(size_t entry_count) {
+    Detach();
+    entries_.reserve(entries_.size() + entry_count);
+}
+
+ForwardIndex::Document ForwardIndex::GetDocument(int document_id) const {
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return {};
+    }
+    const Entry* begin = GetEntries() + it->second.offset;
+    return {begin, begin + it->second.size};
+}
+
+size_t ForwardIndex::GetByteSize() const {
+    return (external_entries_ ? external_entry_count_ : entries_.capacity()) * sizeof(Entry) + documents_.size() * (sizeof(int) + sizeof(Range));
+}
+
+void ForwardIndex::AttachExternal(const Entry* entries, size_t entry_count) {
+    entries_.clear();
+    documents_.clear();
+    removed_entry_count_ = 0;
+    external_entries_ = entries;
+    external_entry_count_ = entry_count;
+}
+
+void ForwardIndex::AttachDocument(int document_id, size_t offset, size_t size) {
+    documents_[document_id] = {offset, size};
+}
+
+bool ForwardIndex::IsValid(size_t term_count) const {
+    for (const auto& [document_id, range] : documents_) {
+        const Entry* entries = GetEntries() + range.offset;
+        for (size_t i = 0; i < range.size; ++i) {
+            if (entries[i].term < 0 || static_cast<size_t>(entries[i].term) >= term_count
+                || (i > 0 && entries[i - 1].term >= entries[i].term) || entries[i].count <= 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Copies only the entries of the stored documents
+void ForwardIndex::Detach() {
+    if (external_entries_) {
+        Compact();
+    }
+}
+
+void ForwardIndex::Compact() {
+    const Entry* source = GetEntries();
+    vector<Entry> entries;
+    entries.reserve(GetEntryCount() - removed_entry_count_);
+    for (auto& [document_id, range] : documents_) {
+        const size_t offset = entries.size();
+        entries.insert(entries.end(), source + range.offset, source + range.offset + range.size);
+        range.offset = offset;
+    }
+    entries_ = move(entries);
+    removed_entry_count_ = 0;
+    external_entries_ = nullptr;
+    external_entry_count_ = 0;
+}
+
+size_t WordFrequencies::count(string_view word) const {
+    if (index_ == nullptr) {
+        return 0;
+    }
+    const auto term = index_->FindTerm(word);
+    return term != InvertedIndex::NO_TERM && document_.Contains(term) ? 1 : 0;
+}
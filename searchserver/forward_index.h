@@ -0,0 +1,154 @@
+#pragma once
+
+#include "inverted_index.h"
+
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Terms of every document with their counts, sorted by term id.
+// Entries of all documents are kept in one array, a document refers to its range.
+// Removed documents leave holes, the array is compacted when holes take half of it.
+// The array may be owned by someone else (e.g. a mapped index file) until an addition or a compaction copies it
+class ForwardIndex {
+public:
+    struct Entry {
+        InvertedIndex::TermId term;
+        int count;
+    };
+
+    // Entries of a document, valid until the next modification of the index
+    struct Document {
+        const Entry* begin = nullptr;
+        const Entry* end = nullptr;
+
+        bool Contains(InvertedIndex::TermId term) const;
+    };
+
+    // Entries must be sorted by term
+    void AddDocument(int document_id, const Entry* entries, size_t entry_count);
+
+    void RemoveDocument(int document_id);
+
+    // Prepares room for entry_count more entries
+    void Reserve(size_t entry_count);
+
+    // Empty for unknown documents
+    Document GetDocument(int document_id) const;
+
+    size_t GetByteSize() const;
+
+    // Uses the entries of all documents without copying, documents are added with AttachDocument.
+    // The entries must outlive the index or its next addition or compaction
+    void AttachExternal(const Entry* entries, size_t entry_count);
+
+    // The document's entries are [offset, offset + size) of the attached array
+    void AttachDocument(int document_id, size_t offset, size_t size);
+
+    // Checks entries read from an untrusted source: terms are less than term_count and increase, counts are positive
+    bool IsValid(size_t term_count) const;
+
+private:
+    struct Range {
+        size_t offset;
+        size_t size;
+    };
+
+    std::vector<Entry> entries_;
+    std::unordered_map<int, Range> documents_;
+    size_t removed_entry_count_ = 0;
+
+    const Entry* external_entries_ = nullptr;
+    size_t external_entry_count_ = 0;
+
+    const Entry* GetEntries() const {
+        return external_entries_ ? external_entries_ : entries_.data();
+    }
+
+    size_t GetEntryCount() const {
+        return external_entries_ ? external_entry_count_ : entries_.size();
+    }
+
+    void Detach();
+    void Compact();
+};
+
+// Words of a document with their frequencies, a view of the forward index.
+// Words go in the order of their term ids. The view is valid until
+// the next modification of the server
+class WordFrequencies {
+public:
+    // Yields pairs by value, so it is only an input iterator
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator(const InvertedIndex* index, const ForwardIndex::Entry* entry, double inv_word_count)
+            : index_(index)
+            , entry_(entry)
+            , inv_word_count_(inv_word_count)
+        {
+        }
+
+        value_type operator*() const {
+            return {index_->GetTerm(entry_->term), entry_->count * inv_word_count_};
+        }
+
+        Iterator& operator++() {
+            ++entry_;
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return entry_ == other.entry_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return entry_ != other.entry_;
+        }
+
+    private:
+        const InvertedIndex* index_;
+        const ForwardIndex::Entry* entry_;
+        double inv_word_count_;
+    };
+
+    WordFrequencies() = default;
+
+    WordFrequencies(const InvertedIndex& index, ForwardIndex::Document document, double inv_word_count)
+        : index_(&index)
+        , document_(document)
+        , inv_word_count_(inv_word_count)
+    {
+    }
+
+    Iterator begin() const {
+        return {index_, document_.begin, inv_word_count_};
+    }
+
+    Iterator end() const {
+        return {index_, document_.end, inv_word_count_};
+    }
+
+    size_t size() const {
+        return document_.end - document_.begin;
+    }
+
+    bool empty() const {
+        return document_.begin == document_.end;
+    }
+
+    // 1 if the document has the word, 0 otherwise
+    size_t count(std::string_view word) const;
+
+private:
+    const InvertedIndex* index_ = nullptr;
+    ForwardIndex::Document document_;
+    double inv_word_count_ = 0.0;
+};
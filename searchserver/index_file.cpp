@@ -0,0 +1,325 @@
+#include "search_server.h"
+
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// Layout of an index file written by SearchServer::SaveIndex.
+// All offsets are from the start of the file, arrays are 8-byte aligned
+namespace {
+
+const char INDEX_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+const uint32_t INDEX_VERSION = 6;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Flags of FileHeader
+const uint64_t POSITION_INDEX_FLAG = 1;
+
+struct StringRecord {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct TermRecord {
+    StringRecord word;
+    uint64_t blocks_offset;
+    uint64_t block_count;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t posting_count;
+    double max_term_freq;
+};
+
+struct DocumentRecord {
+    int32_t id;
+    int32_t rating;
+    int32_t status;
+    int32_t word_count;
+    StringRecord text;
+    // Range of the forward index entries of the document
+    uint64_t first_entry;
+    uint64_t entry_count;
+    // Ranges of the position terms and of the position data of the document
+    uint64_t first_position_term;
+    uint64_t position_term_count;
+    uint64_t position_data_offset;
+    uint64_t position_data_size;
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t stop_words_offset;
+    uint64_t stop_word_count;
+    uint64_t terms_offset;
+    uint64_t term_count;
+    uint64_t documents_offset;
+    uint64_t document_count;
+    // Forward index entries of all documents
+    uint64_t entries_offset;
+    uint64_t entry_count;
+    // Position terms and position data of all documents, if there is the position index
+    uint64_t position_terms_offset;
+    uint64_t position_term_count;
+    uint64_t position_data_offset;
+    uint64_t position_data_size;
+    uint64_t flags;
+};
+
+class IndexWriter {
+public:
+    explicit IndexWriter(const string& path)
+        : out_(path, ios::binary | ios::trunc)
+    {
+        if (!out_) {
+            throw runtime_error("Can't create file "s + path);
+        }
+    }
+
+    uint64_t Write(const void* data, size_t size) {
+        Align();
+        const uint64_t offset = position_;
+        out_.write(static_cast<const char*>(data), size);
+        position_ += size;
+        return offset;
+    }
+
+    StringRecord WriteString(string_view str) {
+        const uint64_t offset = position_;
+        out_.write(str.data(), str.size());
+        position_ += str.size();
+        return {offset, str.size()};
+    }
+
+    template <typename Record>
+    uint64_t WriteArray(const vector<Record>& records) {
+        return Write(records.data(), records.size() * sizeof(Record));
+    }
+
+    void WriteHeader(const FileHeader& header) {
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out_.flush();
+        if (!out_) {
+            throw runtime_error("Can't write index file"s);
+        }
+    }
+
+private:
+    ofstream out_;
+    uint64_t position_ = 0;
+
+    void Align() {
+        static const char padding[8] = {};
+        const size_t size = (8 - position_ % 8) % 8;
+        out_.write(padding, size);
+        position_ += size;
+    }
+};
+
+// Checked access to the mapped file
+class IndexReader {
+public:
+    explicit IndexReader(const MappedFile& file)
+        : file_(file)
+    {
+    }
+
+    template <typename Record>
+    const Record* GetArray(uint64_t offset, uint64_t count) const {
+        CheckRange(offset, count * sizeof(Record));
+        if (offset % alignof(Record) != 0) {
+            throw runtime_error("Corrupted index file"s);
+        }
+        return reinterpret_cast<const Record*>(file_.GetData() + offset);
+    }
+
+    string_view GetString(const StringRecord& record) const {
+        CheckRange(record.offset, record.size);
+        return {file_.GetData() + record.offset, record.size};
+    }
+
+private:
+    const MappedFile& file_;
+
+    void CheckRange(uint64_t offset, uint64_t size) const {
+        if (offset > file_.GetSize() || size > file_.GetSize() - offset) {
+            throw runtime_error("Corrupted index file"s);
+        }
+    }
+};
+
+// [first, first + count) lies in [0, size)
+bool IsValidRange(uint64_t first, uint64_t count, uint64_t size) {
+    return first <= size && count <= size - first;
+}
+
+}  // namespace
+
+void SearchServer::SaveIndex(const string& path) const {
+    IndexWriter writer(path);
+    FileHeader header = {};
+    writer.Write(&header, sizeof(header));
+
+    vector<StringRecord> stop_words;
+    for (const auto& word : stop_words_) {
+        stop_words.push_back(writer.WriteString(word));
+    }
+
+    vector<TermRecord> terms;
+    terms.reserve(index_.GetTermCount());
+    for (InvertedIndex::TermId term = 0; term < static_cast<InvertedIndex::TermId>(index_.GetTermCount()); ++term) {
+        const auto& postings = index_.GetPostings(term);
+        TermRecord record = {};
+        record.word = writer.WriteString(index_.GetTerm(term));
+        record.block_count = postings.GetBlockCount();
+        record.blocks_offset = writer.Write(postings.GetBlocks(), postings.GetBlockCount() * sizeof(PostingList::Block));
+        record.data_size = postings.GetDataSize();
+        record.data_offset = writer.Write(postings.GetData(), postings.GetDataSize());
+        record.posting_count = postings.size();
+        record.max_term_freq = index_.GetStatistics(term).max_term_freq;
+        terms.push_back(record);
+    }
+
+    vector<DocumentRecord> documents;
+    documents.reserve(documents_.size());
+    vector<ForwardIndex::Entry> entries;
+    vector<PositionIndex::TermPositions> position_terms;
+    vector<uint8_t> position_data;
+    for (const int document_id : document_ids_) {
+        DocumentRecord record = {};
+        record.id = document_id;
+        record.rating = documents_.GetRating(document_id);
+        record.status = static_cast<int32_t>(documents_.GetStatus(document_id));
+        record.word_count = documents_.GetWordCount(document_id);
+        record.text = writer.WriteString(documents_.GetText(document_id));
+        const auto forward_document = forward_index_.GetDocument(document_id);
+        record.first_entry = entries.size();
+        record.entry_count = forward_document.end - forward_document.begin;
+        entries.insert(entries.end(), forward_document.begin, forward_document.end);
+        if (position_index_) {
+            const auto positions = position_index_->GetDocument(document_id);
+            record.first_position_term = position_terms.size();
+            record.position_term_count = positions.term_count;
+            position_terms.insert(position_terms.end(), positions.terms, positions.terms + positions.term_count);
+            record.position_data_offset = position_data.size();
+            record.position_data_size = positions.data_size;
+            position_data.insert(position_data.end(), positions.data, positions.data + positions.data_size);
+        }
+        documents.push_back(record);
+    }
+
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.stop_word_count = stop_words.size();
+    header.stop_words_offset = writer.WriteArray(stop_words);
+    header.term_count = terms.size();
+    header.terms_offset = writer.WriteArray(terms);
+    header.document_count = documents.size();
+    header.documents_offset = writer.WriteArray(documents);
+    header.entry_count = entries.size();
+    header.entries_offset = writer.WriteArray(entries);
+    header.position_term_count = position_terms.size();
+    header.position_terms_offset = writer.WriteArray(position_terms);
+    header.position_data_size = position_data.size();
+    header.position_data_offset = writer.WriteArray(position_data);
+    header.flags = position_index_ ? POSITION_INDEX_FLAG : 0;
+    writer.WriteHeader(header);
+}
+
+SearchServer SearchServer::OpenIndex(const string& path) {
+    auto file = make_shared<const MappedFile>(path);
+    const IndexReader reader(*file);
+
+    const auto& header = *reader.GetArray<FileHeader>(0, 1);
+    if (memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != INDEX_VERSION
+        || header.byte_order != BYTE_ORDER_MARK) {
+        throw runtime_error("Unsupported index file "s + path);
+    }
+
+    vector<string> stop_words;
+    const auto* stop_word_records = reader.GetArray<StringRecord>(header.stop_words_offset, header.stop_word_count);
+    for (uint64_t i = 0; i < header.stop_word_count; ++i) {
+        stop_words.emplace_back(reader.GetString(stop_word_records[i]));
+    }
+    SearchServer server(stop_words);
+    if (header.flags & POSITION_INDEX_FLAG) {
+        server.EnablePositionIndex();
+    }
+
+    const auto* terms = reader.GetArray<TermRecord>(header.terms_offset, header.term_count);
+    for (uint64_t i = 0; i < header.term_count; ++i) {
+        const auto& record = terms[i];
+        const auto* blocks = reader.GetArray<PostingList::Block>(record.blocks_offset, record.block_count);
+        const auto* data = reader.GetArray<uint8_t>(record.data_offset, record.data_size);
+        // Searches trust the block headers, so a damaged table is rejected here. Postings are checked by VerifyIndex
+        if (!PostingList::IsValidLayout(blocks, record.block_count, record.data_size, record.posting_count)) {
+            throw runtime_error("Corrupted index file"s);
+        }
+        const auto term = server.index_.AddExternalTerm(reader.GetString(record.word));
+        if (static_cast<uint64_t>(term) != i) {
+            throw runtime_error("Corrupted index file"s);
+        }
+        server.index_.AttachExternalPostings(term, blocks, record.block_count, data, record.data_size,
+                                             record.posting_count, record.max_term_freq);
+    }
+
+    server.forward_index_.AttachExternal(reader.GetArray<ForwardIndex::Entry>(header.entries_offset, header.entry_count),
+                                         header.entry_count);
+    const PositionIndex::TermPositions* position_terms = nullptr;
+    const uint8_t* position_data = nullptr;
+    if (server.position_index_) {
+        position_terms = reader.GetArray<PositionIndex::TermPositions>(header.position_terms_offset, header.position_term_count);
+        position_data = reader.GetArray<uint8_t>(header.position_data_offset, header.position_data_size);
+    }
+
+    // Records are sorted by id, so every insertion goes to the end
+    const auto* documents = reader.GetArray<DocumentRecord>(header.documents_offset, header.document_count);
+    for (uint64_t i = 0; i < header.document_count; ++i) {
+        const auto& record = documents[i];
+        if (record.id < 0 || (i > 0 && documents[i - 1].id >= record.id) || record.status < 0
+            || record.status > static_cast<int32_t>(DocumentStatus::REMOVED) || record.word_count < 0
+            || !IsValidRange(record.first_entry, record.entry_count, header.entry_count)) {
+            throw runtime_error("Corrupted index file"s);
+        }
+        server.documents_.Add(record.id, static_cast<DocumentStatus>(record.status), record.rating, record.word_count,
+                              reader.GetString(record.text));
+        server.word_count_ += record.word_count;
+        server.forward_index_.AttachDocument(record.id, record.first_entry, record.entry_count);
+        if (server.position_index_) {
+            if (!IsValidRange(record.first_position_term, record.position_term_count, header.position_term_count)
+                || !IsValidRange(record.position_data_offset, record.position_data_size, header.position_data_size)) {
+                throw runtime_error("Corrupted index file"s);
+            }
+            server.position_index_->AttachDocument(record.id, {position_terms + record.first_position_term, record.position_term_count,
+                                                               position_data + record.position_data_offset, record.position_data_size});
+        }
+        server.document_ids_.emplace_hint(server.document_ids_.end(), record.id);
+    }
+
+    server.index_file_ = move(file);
+    return server;
+}
+
+void SearchServer::VerifyIndex() const {
+    for (InvertedIndex::TermId term = 0; term < static_cast<InvertedIndex::TermId>(index_.GetTermCount()); ++term) {
+        const auto& postings = index_.GetPostings(term);
+        if (!postings.IsValidEncoding()) {
+            throw runtime_error("Corrupted index file"s);
+        }
+        // Scoring reads the metadata of posted documents without looking them up
+        for (const auto& posting : postings) {
+            if (!documents_.Contains(posting.document_id)) {
+                throw runtime_error("Corrupted index file"s);
+            }
+        }
+    }
+    // Terms of the entries index the dictionary
+    if (!forward_index_.IsValid(index_.GetTermCount())
+        || (position_index_ && !position_index_->IsValid(index_.GetTermCount()))) {
+        throw runtime_error("Corrupted index file"s);
+    }
+}
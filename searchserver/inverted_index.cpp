@@ -0,0 +1,88 @@
+#include "inverted_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+InvertedIndex::TermId InvertedIndex::AddTerm(string_view word) {
+    const auto it = term_ids_.find(word);
+    if (it != term_ids_.end()) {
+        return it->second;
+    }
+    owned_terms_.emplace_back(word);
+    return AddExternalTerm(owned_terms_.back());
+}
+
+InvertedIndex::TermId InvertedIndex::AddExternalTerm(string_view word) {
+    if (const auto it = term_ids_.find(word); it != term_ids_.end()) {
+        return it->second;
+    }
+    const TermId term = static_cast<TermId>(terms_.size());
+    terms_.push_back(word);
+    term_ids_.emplace(word, term);
+    postings_.emplace_back();
+    statistics_.emplace_back();
+    return term;
+}
+
+InvertedIndex::TermId InvertedIndex::FindTerm(string_view word) const {
+    const auto it = term_ids_.find(word);
+    return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+string_view InvertedIndex::GetTerm(TermId term) const {
+    return terms_[term];
+}
+
+size_t InvertedIndex::GetTermCount() const {
+    return terms_.size();
+}
+
+size_t InvertedIndex::GetPostingCount() const {
+    size_t count = 0;
+    for (const auto& postings : postings_) {
+        count += postings.size();
+    }
+    return count;
+}
+
+size_t InvertedIndex::GetPostingBytes() const {
+    size_t bytes = 0;
+    for (const auto& postings : postings_) {
+        bytes += postings.GetByteSize();
+    }
+    return bytes;
+}
+
+const PostingList& InvertedIndex::GetPostings(TermId term) const {
+    return postings_[term];
+}
+
+const InvertedIndex::TermStatistics& InvertedIndex::GetStatistics(TermId term) const {
+    return statistics_[term];
+}
+
+void InvertedIndex::AddPosting(TermId term, int document_id, int count, double term_freq) {
+    postings_[term].Add(document_id, count);
+    UpdateDocumentFreq(term);
+    statistics_[term].max_term_freq = max(statistics_[term].max_term_freq, term_freq);
+}
+
+void InvertedIndex::RemovePosting(TermId term, int document_id) {
+    postings_[term].Remove(document_id);
+    UpdateDocumentFreq(term);
+}
+
+void InvertedIndex::AttachExternalPostings(TermId term, const PostingList::Block* blocks, size_t block_count,
+                                           const uint8_t* data, size_t data_size, size_t posting_count, double max_term_freq) {
+    postings_[term].AttachExternal(blocks, block_count, data, data_size, posting_count);
+    UpdateDocumentFreq(term);
+    statistics_[term].max_term_freq = max_term_freq;
+}
+
+void InvertedIndex::UpdateDocumentFreq(TermId term) {
+    const size_t document_freq = postings_[term].size();
+    // Terms without postings never get into a query, the value is just kept finite
+    statistics_[term].log_document_freq = document_freq == 0 ? 0.0 : log(static_cast<double>(document_freq));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "posting_list.h"
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index with an interned term dictionary.
+// Every distinct word gets a dense id, postings of a term are stored
+// in a compressed list sorted by document id
+class InvertedIndex {
+public:
+    using TermId = int;
+    static const TermId NO_TERM = -1;
+
+    // Per-term values kept up to date by the modifications, so a query doesn't recompute them
+    struct TermStatistics {
+        // log of the number of documents with the term, IDF is log(N) minus this
+        double log_document_freq = 0.0;
+        // Upper bound of the term frequency over the postings. Removals don't lower it,
+        // it stays a valid bound, just a looser one
+        double max_term_freq = 0.0;
+    };
+
+    // Returns id of the word, adding it to the dictionary if needed
+    TermId AddTerm(std::string_view word);
+
+    // Adds a new word without copying it, the word must outlive the index
+    TermId AddExternalTerm(std::string_view word);
+
+    // Returns NO_TERM for unknown words
+    TermId FindTerm(std::string_view word) const;
+
+    // The view stays valid for the lifetime of the index
+    std::string_view GetTerm(TermId term) const;
+
+    size_t GetTermCount() const;
+
+    size_t GetPostingCount() const;
+
+    // Memory taken by the encoded postings
+    size_t GetPostingBytes() const;
+
+    const PostingList& GetPostings(TermId term) const;
+
+    const TermStatistics& GetStatistics(TermId term) const;
+
+    // count is the number of occurrences of the term in the document,
+    // term_freq is that count divided by the document length
+    void AddPosting(TermId term, int document_id, int count, double term_freq);
+
+    void RemovePosting(TermId term, int document_id);
+
+    // Makes postings of the term use encoded data placed outside of the index
+    void AttachExternalPostings(TermId term, const PostingList::Block* blocks, size_t block_count,
+                                const uint8_t* data, size_t data_size, size_t posting_count, double max_term_freq);
+
+private:
+    // deque keeps strings in place, so views to them never dangle
+    std::deque<std::string> owned_terms_;
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, TermId> term_ids_;
+    std::vector<PostingList> postings_;
+    std::vector<TermStatistics> statistics_;
+
+    void UpdateDocumentFreq(TermId term);
+};
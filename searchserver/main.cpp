@@ -2,7 +2,9 @@
 #include "log_duration.h"
 #include "process_queries.h"
 #include "search_server.h"
+#include "test_example_functions.h"
 
+#include <chrono>
 #include <execution>
 #include <iostream>
 #include <random>
@@ -68,19 +70,85 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
 
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
+void TestTokenizer(const vector<string>& texts) {
+    size_t byte_count = 0;
+    size_t word_count = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int pass = 0; pass < 10; ++pass) {
+        for (const string& text : texts) {
+            byte_count += text.size();
+            ForEachWordView(text, [&word_count](string_view) {
+                ++word_count;
+            });
+        }
+    }
+    const chrono::duration<double> duration = chrono::steady_clock::now() - start;
+    cout << "tokenizer: "s << byte_count / duration.count() / (1 << 20) << " MB/s, "s << word_count << " words"s << endl;
+}
+
+template <typename Processor>
+void TestProcessQueries(string_view mark, const SearchServer& search_server, const vector<string>& queries, Processor processor) {
+    LOG_DURATION(mark);
+    double total_relevance = 0;
+    for (const auto& documents : processor(search_server, queries)) {
+        for (const auto& document : documents) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
 int main() {
+    TestSearchServer();
+
     mt19937 generator;
 
     const auto dictionary = GenerateDictionary(generator, 1000, 10);
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
 
+    TestTokenizer(documents);
+
     SearchServer search_server(dictionary[0]);
-    for (size_t i = 0; i < documents.size(); ++i) {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    {
+        vector<RawDocument> batch;
+        batch.reserve(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            batch.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+        }
+        LOG_DURATION("indexing"s);
+        search_server.AddDocuments(batch);
     }
 
+    const auto index_statistics = search_server.GetIndexStatistics();
+    cout << "postings: "s << index_statistics.posting_count << ", bytes/posting: "s
+         << index_statistics.posting_bytes * 1.0 / index_statistics.posting_count
+         << ", forward index bytes/posting: "s << index_statistics.forward_bytes * 1.0 / index_statistics.posting_count << endl;
+
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
 
     TEST(seq);
     TEST(par);
+
+    search_server.SetRankingModel(RankingModel::BM25);
+    Test("BM25"s, search_server, queries, execution::seq);
+    search_server.SetRankingModel(RankingModel::TF_IDF);
+
+    vector<SearchServer::PreparedQuery> prepared_queries;
+    for (const string& query : queries) {
+        prepared_queries.push_back(search_server.PrepareQuery(query));
+    }
+    {
+        LOG_DURATION("prepared"s);
+        double total_relevance = 0;
+        for (const auto& query : prepared_queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+
+    const auto batch_queries = GenerateQueries(generator, dictionary, 10'000, 10);
+    TestProcessQueries("ProcessQueries"s, search_server, batch_queries, ProcessQueries);
+    TestProcessQueries("ProcessQueriesBatched"s, search_server, batch_queries, ProcessQueriesBatched);
 }
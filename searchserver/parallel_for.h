@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <vector>
+
+// Calls function(i) for every i in [0, count) in parallel.
+// Exceptions can't leave a parallel algorithm, so they are caught in the workers
+// and the one of the lowest index is rethrown once all calls are finished
+template <typename Function>
+void ForEachIndexParallel(size_t count, Function function) {
+    std::vector<size_t> indexes(count);
+    for (size_t i = 0; i < count; ++i) {
+        indexes[i] = i;
+    }
+    std::vector<std::exception_ptr> errors(count);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        try {
+            function(index);
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    });
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
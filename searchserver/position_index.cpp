@@ -0,0 +1,99 @@
+#include "position_index.h"
+#include "varint.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+void PositionIndex::AddDocument(int document_id, const vector<InvertedIndex::TermId>& terms) {
+    vector<pair<InvertedIndex::TermId, int>> term_positions;
+    term_positions.reserve(terms.size());
+    for (size_t position = 0; position < terms.size(); ++position) {
+        if (terms[position] != InvertedIndex::NO_TERM) {
+            term_positions.emplace_back(terms[position], static_cast<int>(position));
+        }
+    }
+    sort(term_positions.begin(), term_positions.end());
+
+    auto& document = documents_[document_id];
+    document.terms.clear();
+    document.data.clear();
+    for (size_t begin = 0, end = 0; begin < term_positions.size(); begin = end) {
+        const auto term = term_positions[begin].first;
+        const auto offset = static_cast<uint32_t>(document.data.size());
+        int previous_position = 0;
+        for (end = begin; end < term_positions.size() && term_positions[end].first == term; ++end) {
+            WriteVarint(document.data, static_cast<uint32_t>(term_positions[end].second - previous_position));
+            previous_position = term_positions[end].second;
+        }
+        document.terms.push_back({term, offset, static_cast<uint32_t>(end - begin)});
+    }
+    document.terms.shrink_to_fit();
+    document.data.shrink_to_fit();
+    document.view = {document.terms.data(), document.terms.size(), document.data.data(), document.data.size()};
+}
+
+void PositionIndex::RemoveDocument(int document_id) {
+    documents_.erase(document_id);
+}
+
+void PositionIndex::GetPositions(int document_id, InvertedIndex::TermId term, vector<int>& positions) const {
+    positions.clear();
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return;
+    }
+    const auto& view = document->second.view;
+    const TermPositions* terms_end = view.terms + view.term_count;
+    const auto it = lower_bound(view.terms, terms_end, term, [](const TermPositions& entry, InvertedIndex::TermId term) {
+        return entry.term < term;
+    });
+    if (it == terms_end || it->term != term) {
+        return;
+    }
+    const uint8_t* data = view.data + it->offset;
+    int position = 0;
+    for (uint32_t i = 0; i < it->count; ++i) {
+        position += static_cast<int>(ReadVarint(data));
+        positions.push_back(position);
+    }
+}
+
+PositionIndex::Document PositionIndex::GetDocument(int document_id) const {
+    const auto document = documents_.find(document_id);
+    return document != documents_.end() ? document->second.view : Document{};
+}
+
+void PositionIndex::AttachDocument(int document_id, Document document) {
+    documents_[document_id] = {document, {}, {}};
+}
+
+bool PositionIndex::IsValid(size_t term_count) const {
+    for (const auto& [document_id, document] : documents_) {
+        const auto& view = document.view;
+        for (size_t i = 0; i < view.term_count; ++i) {
+            const auto& term = view.terms[i];
+            if (term.term < 0 || static_cast<size_t>(term.term) >= term_count
+                || (i > 0 && view.terms[i - 1].term >= term.term) || term.count == 0 || term.offset > view.data_size) {
+                return false;
+            }
+            const uint8_t* data = view.data + term.offset;
+            for (uint32_t j = 0; j < term.count; ++j) {
+                uint32_t gap = 0;
+                if (!ReadVarintChecked(data, view.data + view.data_size, gap) || (j > 0 && gap == 0)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+size_t PositionIndex::GetByteSize() const {
+    size_t byte_size = 0;
+    for (const auto& [document_id, document] : documents_) {
+        byte_size += document.view.data_size + document.view.term_count * sizeof(TermPositions);
+    }
+    return byte_size;
+}
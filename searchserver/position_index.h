@@ -0,0 +1,60 @@
+#pragma once
+
+#include "inverted_index.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Positions of the words in the documents, used to check phrase and proximity queries.
+// Every document keeps a table of its terms sorted by id, positions of a term
+// are encoded as varint gaps in the buffer of the document.
+// Positions count all words of the text, stop words included
+class PositionIndex {
+public:
+    struct TermPositions {
+        InvertedIndex::TermId term;
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // Positions of a document, valid until the document is removed
+    struct Document {
+        const TermPositions* terms = nullptr;
+        size_t term_count = 0;
+        const uint8_t* data = nullptr;
+        size_t data_size = 0;
+    };
+
+    // terms are the words of the document in the text order, NO_TERM for the words without postings
+    void AddDocument(int document_id, const std::vector<InvertedIndex::TermId>& terms);
+
+    void RemoveDocument(int document_id);
+
+    // Positions of the term in the document in increasing order, empty if there are none
+    void GetPositions(int document_id, InvertedIndex::TermId term, std::vector<int>& positions) const;
+
+    // Empty for unknown documents
+    Document GetDocument(int document_id) const;
+
+    // Uses positions owned by someone else (e.g. a mapped index file) without copying.
+    // They must outlive the index or the removal of the document
+    void AttachDocument(int document_id, Document document);
+
+    // Checks positions read from an untrusted source: terms are less than term_count and increase,
+    // positions of every term decode within the data of the document and increase
+    bool IsValid(size_t term_count) const;
+
+    // Memory taken by the encoded positions
+    size_t GetByteSize() const;
+
+private:
+    struct DocumentPositions {
+        Document view;
+        // Empty for attached documents
+        std::vector<TermPositions> terms;
+        std::vector<uint8_t> data;
+    };
+
+    std::unordered_map<int, DocumentPositions> documents_;
+};
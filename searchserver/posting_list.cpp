@@ -0,0 +1,232 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PostingList::Iterator::Iterator(const PostingList* postings, size_t block)
+    : postings_(postings)
+{
+    LoadBlock(block);
+}
+
+void PostingList::Iterator::LoadBlock(size_t block) {
+    block_ = block;
+    position_ = 0;
+    if (block_ >= postings_->GetBlockCount()) {
+        block_ = postings_->GetBlockCount();
+        block_end_ = 0;
+        return;
+    }
+    const auto& header = postings_->GetBlocks()[block_];
+    block_end_ = static_cast<int>(header.size);
+    data_ = postings_->GetData() + header.offset;
+    posting_.document_id = header.first_document_id;
+    Decode();
+}
+
+void PostingList::Iterator::Seek(int document_id) {
+    const Block* blocks = postings_->GetBlocks();
+    const size_t block_count = postings_->GetBlockCount();
+    if (block_ == block_count || posting_.document_id >= document_id) {
+        return;
+    }
+    if (blocks[block_].last_document_id < document_id) {
+        const auto it = partition_point(blocks + block_ + 1, blocks + block_count, [document_id](const Block& block) {
+            return block.last_document_id < document_id;
+        });
+        LoadBlock(it - blocks);
+    }
+    while (block_ != block_count && posting_.document_id < document_id) {
+        ++*this;
+    }
+}
+
+PostingList::Iterator PostingList::begin() const {
+    return Iterator(this, 0);
+}
+
+PostingList::Iterator PostingList::end() const {
+    return Iterator(this, GetBlockCount());
+}
+
+PostingList::Iterator PostingList::LowerBound(int document_id) const {
+    auto it = Iterator(this, FindBlock(document_id));
+    it.Seek(document_id);
+    return it;
+}
+
+bool PostingList::Contains(int document_id) const {
+    const auto it = LowerBound(document_id);
+    return it != end() && it->document_id == document_id;
+}
+
+void PostingList::Decode(int first_document_id, int64_t last_document_id, vector<int>& document_ids, vector<int>& counts) const {
+    document_ids.clear();
+    counts.clear();
+    for (auto it = LowerBound(first_document_id); it != end() && it->document_id < last_document_id; ++it) {
+        document_ids.push_back(it->document_id);
+        counts.push_back(it->count);
+    }
+}
+
+void PostingList::Add(int document_id, int count) {
+    Detach();
+    // Documents usually arrive with growing ids, so appending is the common case
+    if (blocks_.empty() || blocks_.back().last_document_id < document_id) {
+        if (blocks_.empty() || blocks_.back().size == BLOCK_SIZE) {
+            blocks_.push_back({document_id, document_id, static_cast<uint32_t>(data_.size()), 0});
+        }
+        auto& block = blocks_.back();
+        WriteVarint(data_, static_cast<uint32_t>(document_id - block.last_document_id));
+        WriteVarint(data_, static_cast<uint32_t>(count));
+        block.last_document_id = document_id;
+        ++block.size;
+        ++size_;
+        return;
+    }
+    const size_t block = FindBlock(document_id);
+    auto postings = DecodeBlock(block);
+    const auto it = lower_bound(postings.begin(), postings.end(), document_id, [](const Posting& posting, int id) {
+        return posting.document_id < id;
+    });
+    if (it != postings.end() && it->document_id == document_id) {
+        it->count += count;
+    } else {
+        postings.insert(it, {document_id, count});
+        ++size_;
+    }
+    ReplaceBlock(block, postings);
+}
+
+void PostingList::Remove(int document_id) {
+    Detach();
+    const size_t block = FindBlock(document_id);
+    if (block == blocks_.size() || blocks_[block].first_document_id > document_id) {
+        return;
+    }
+    auto postings = DecodeBlock(block);
+    const auto it = lower_bound(postings.begin(), postings.end(), document_id, [](const Posting& posting, int id) {
+        return posting.document_id < id;
+    });
+    if (it == postings.end() || it->document_id != document_id) {
+        return;
+    }
+    postings.erase(it);
+    --size_;
+    ReplaceBlock(block, postings);
+}
+
+size_t PostingList::GetByteSize() const {
+    return GetDataSize() + GetBlockCount() * sizeof(Block);
+}
+
+void PostingList::AttachExternal(const Block* blocks, size_t block_count, const uint8_t* data, size_t data_size, size_t posting_count) {
+    blocks_.clear();
+    data_.clear();
+    external_blocks_ = blocks;
+    external_block_count_ = block_count;
+    external_data_ = data;
+    external_data_size_ = data_size;
+    size_ = posting_count;
+}
+
+bool PostingList::IsValidLayout(const Block* blocks, size_t block_count, size_t data_size, size_t posting_count) {
+    size_t total_size = 0;
+    for (size_t block = 0; block < block_count; ++block) {
+        const auto& header = blocks[block];
+        const uint64_t end = block + 1 < block_count ? blocks[block + 1].offset : data_size;
+        if (header.offset > end || end > data_size || header.size == 0 || header.size > BLOCK_SIZE
+            || header.first_document_id < 0 || header.first_document_id > header.last_document_id
+            || (block > 0 && blocks[block - 1].last_document_id >= header.first_document_id)) {
+            return false;
+        }
+        total_size += header.size;
+    }
+    return total_size == posting_count;
+}
+
+bool PostingList::IsValidEncoding() const {
+    const Block* blocks = GetBlocks();
+    const uint8_t* data = GetData();
+    for (size_t block = 0; block < GetBlockCount(); ++block) {
+        const auto& header = blocks[block];
+        const uint8_t* position = data + header.offset;
+        const uint8_t* block_end = data + (block + 1 < GetBlockCount() ? blocks[block + 1].offset : GetDataSize());
+        int64_t document_id = header.first_document_id;
+        for (uint32_t i = 0; i < header.size; ++i) {
+            uint32_t gap = 0;
+            uint32_t count = 0;
+            if (!ReadVarintChecked(position, block_end, gap) || !ReadVarintChecked(position, block_end, count)
+                || (i == 0) != (gap == 0)) {
+                return false;
+            }
+            document_id += gap;
+        }
+        if (position != block_end || document_id != header.last_document_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PostingList::Detach() {
+    if (!external_blocks_) {
+        return;
+    }
+    blocks_.assign(external_blocks_, external_blocks_ + external_block_count_);
+    data_.assign(external_data_, external_data_ + external_data_size_);
+    external_blocks_ = nullptr;
+    external_block_count_ = 0;
+    external_data_ = nullptr;
+    external_data_size_ = 0;
+}
+
+size_t PostingList::FindBlock(int document_id) const {
+    const Block* blocks = GetBlocks();
+    const auto it = partition_point(blocks, blocks + GetBlockCount(), [document_id](const Block& block) {
+        return block.last_document_id < document_id;
+    });
+    return it - blocks;
+}
+
+uint32_t PostingList::GetBlockEnd(size_t block) const {
+    return block + 1 < blocks_.size() ? blocks_[block + 1].offset : static_cast<uint32_t>(data_.size());
+}
+
+vector<PostingList::Posting> PostingList::DecodeBlock(size_t block) const {
+    vector<Posting> postings;
+    postings.reserve(GetBlocks()[block].size);
+    for (Iterator it(this, block); it.block_ == block; ++it) {
+        postings.push_back(*it);
+    }
+    return postings;
+}
+
+// Re-encodes the block, splitting it if it overflows or dropping it if it's empty
+void PostingList::ReplaceBlock(size_t block, const vector<Posting>& postings) {
+    vector<Block> blocks;
+    vector<uint8_t> data;
+    const uint32_t offset = blocks_[block].offset;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (i % BLOCK_SIZE == 0) {
+            blocks.push_back({postings[i].document_id, postings[i].document_id,
+                              offset + static_cast<uint32_t>(data.size()), 0});
+        }
+        auto& header = blocks.back();
+        WriteVarint(data, static_cast<uint32_t>(postings[i].document_id - header.last_document_id));
+        WriteVarint(data, static_cast<uint32_t>(postings[i].count));
+        header.last_document_id = postings[i].document_id;
+        ++header.size;
+    }
+
+    const uint32_t old_end = GetBlockEnd(block);
+    const int64_t shift = static_cast<int64_t>(data.size()) - (old_end - offset);
+    data_.erase(data_.begin() + offset, data_.begin() + old_end);
+    data_.insert(data_.begin() + offset, data.begin(), data.end());
+    for (size_t i = block + 1; i < blocks_.size(); ++i) {
+        blocks_[i].offset = static_cast<uint32_t>(blocks_[i].offset + shift);
+    }
+    blocks_.erase(blocks_.begin() + block);
+    blocks_.insert(blocks_.begin() + block, blocks.begin(), blocks.end());
+}
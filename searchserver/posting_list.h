@@ -0,0 +1,162 @@
+#pragma once
+
+#include "varint.h"
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Compressed posting list of a term.
+// Postings are sorted by document id and split into blocks of up to BLOCK_SIZE.
+// Inside a block every posting is a pair of varints: the gap from the previous
+// document id and the number of occurrences of the term in the document.
+// Block headers keep the id range of a block, so a search skips whole blocks
+class PostingList {
+public:
+    static const uint32_t BLOCK_SIZE = 128;
+
+    // Header of a block, data offsets are relative to the list's encoded data
+    struct Block {
+        int first_document_id;
+        int last_document_id;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Posting {
+        int document_id = 0;
+        int count = 0;
+    };
+
+    // Decodes postings on the fly
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Posting;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Posting*;
+        using reference = const Posting&;
+
+        Iterator() = default;
+
+        reference operator*() const {
+            return posting_;
+        }
+
+        pointer operator->() const {
+            return &posting_;
+        }
+
+        Iterator& operator++() {
+            if (++position_ == block_end_) {
+                LoadBlock(block_ + 1);
+            } else {
+                Decode();
+            }
+            return *this;
+        }
+
+        // Moves to the first posting with id not less than document_id
+        void Seek(int document_id);
+
+        bool operator==(const Iterator& other) const {
+            return block_ == other.block_ && position_ == other.position_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class PostingList;
+
+        const PostingList* postings_ = nullptr;
+        size_t block_ = 0;
+        int position_ = 0;
+        int block_end_ = 0;
+        const uint8_t* data_ = nullptr;
+        Posting posting_;
+
+        Iterator(const PostingList* postings, size_t block);
+        void LoadBlock(size_t block);
+
+        void Decode() {
+            posting_.document_id += static_cast<int>(ReadVarint(data_));
+            posting_.count = static_cast<int>(ReadVarint(data_));
+        }
+    };
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    // Iterator to the first posting with id not less than document_id
+    Iterator LowerBound(int document_id) const;
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    bool Contains(int document_id) const;
+
+    // Decodes postings with ids in [first_document_id, last_document_id) into parallel arrays
+    void Decode(int first_document_id, int64_t last_document_id, std::vector<int>& document_ids, std::vector<int>& counts) const;
+
+    // Adds count to the posting of the document, creating it if needed
+    void Add(int document_id, int count);
+
+    void Remove(int document_id);
+
+    size_t GetByteSize() const;
+
+    // Encoded representation, used to store the list in an index file
+    const Block* GetBlocks() const {
+        return external_blocks_ ? external_blocks_ : blocks_.data();
+    }
+
+    size_t GetBlockCount() const {
+        return external_blocks_ ? external_block_count_ : blocks_.size();
+    }
+
+    const uint8_t* GetData() const {
+        return external_blocks_ ? external_data_ : data_.data();
+    }
+
+    size_t GetDataSize() const {
+        return external_blocks_ ? external_data_size_ : data_.size();
+    }
+
+    // Uses encoded data owned by someone else (e.g. a mapped index file) without copying.
+    // The data must outlive the list or its first modification
+    void AttachExternal(const Block* blocks, size_t block_count, const uint8_t* data, size_t data_size, size_t posting_count);
+
+    // Checks block headers read from an untrusted source in O(blocks): blocks lie inside the data
+    // in order, their id ranges grow and their sizes sum to posting_count. The postings aren't decoded
+    static bool IsValidLayout(const Block* blocks, size_t block_count, size_t data_size, size_t posting_count);
+
+    // Checks that the postings of a list with a valid layout decode within their blocks
+    // to the id ranges of the headers
+    bool IsValidEncoding() const;
+
+private:
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> data_;
+    size_t size_ = 0;
+
+    // Attached data is used in place until a modification copies it into blocks_ and data_
+    const Block* external_blocks_ = nullptr;
+    size_t external_block_count_ = 0;
+    const uint8_t* external_data_ = nullptr;
+    size_t external_data_size_ = 0;
+
+    void Detach();
+
+    // Index of the first block that may contain document_id
+    size_t FindBlock(int document_id) const;
+    uint32_t GetBlockEnd(size_t block) const;
+    std::vector<Posting> DecodeBlock(size_t block) const;
+    void ReplaceBlock(size_t block, const std::vector<Posting>& postings);
+};
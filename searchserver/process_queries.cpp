@@ -11,16 +11,55 @@ std::vector<std::vector<Document>> ProcessQueries(
             [&search_server](const std::string& query) { return search_server.FindTopDocuments(query);});
         return result;
     }
-    
-std::list<Document> ProcessQueriesJoined(
+
+std::vector<std::vector<Document>> ProcessQueriesBatched(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-        auto vv=ProcessQueries(search_server,queries);
-        std::list<Document> result;
-        for (const auto& v : vv) {
-            for (const auto& d : v) {
-                result.push_back(d);
-            }
+        return search_server.FindTopDocumentsBatch(queries);
+    }
+    
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++() {
+    if (++position_ == owner_->documents_.size()) {
+        owner_->LoadNextChunk();
+        position_ = 0;
+    }
+    return *this;
+}
+
+JoinedDocuments::JoinedDocuments(const SearchServer& search_server, const std::vector<std::string>& queries, size_t chunk_size)
+    : search_server_(search_server)
+    , queries_(queries)
+    , chunk_size_(std::max<size_t>(chunk_size, 1))
+{
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() {
+    LoadNextChunk();
+    return Iterator(this);
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() {
+    return Iterator();
+}
+
+void JoinedDocuments::LoadNextChunk() {
+    documents_.clear();
+    std::vector<std::vector<Document>> chunk_results;
+    while (documents_.empty() && next_query_ < queries_.size()) {
+        const auto first = queries_.begin() + next_query_;
+        const auto last = queries_.begin() + std::min(next_query_ + chunk_size_, queries_.size());
+        chunk_results.resize(last - first);
+        std::transform(std::execution::par, first, last, chunk_results.begin(),
+            [this](const std::string& query) { return search_server_.FindTopDocuments(query); });
+        next_query_ += last - first;
+        for (const auto& documents : chunk_results) {
+            documents_.insert(documents_.end(), documents.begin(), documents.end());
         }
-    return result;
-    }     
\ No newline at end of file
+    }
+}
+
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+        return JoinedDocuments(search_server, queries);
+    }
@@ -1,12 +1,94 @@
 #pragma once
 #include "search_server.h"
-#include<list> 
+
+#include <iterator>
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries); 
 
+// Same results as ProcessQueries, queries sharing terms decode the postings once
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// Results of all queries one after another, in the order of queries.
+// Queries are evaluated lazily, a chunk at a time, while the range is iterated:
+// the first results are available before the whole batch is processed and
+// only the results of the current chunk are kept, in one contiguous buffer.
+// The server and the queries must outlive the range
+class JoinedDocuments {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 1024;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+
+        reference operator*() const {
+            return owner_->documents_[position_];
+        }
+
+        pointer operator->() const {
+            return &owner_->documents_[position_];
+        }
+
+        Iterator& operator++();
+
+        // Iterators compare equal only at the end, as for any input range
+        bool operator==(const Iterator& other) const {
+            return IsEnd() && other.IsEnd();
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class JoinedDocuments;
+
+        JoinedDocuments* owner_ = nullptr;
+        size_t position_ = 0;
+
+        explicit Iterator(JoinedDocuments* owner)
+            : owner_(owner)
+        {
+        }
+
+        bool IsEnd() const {
+            return owner_ == nullptr || position_ == owner_->documents_.size();
+        }
+    };
+
+    JoinedDocuments(const SearchServer& search_server, const std::vector<std::string>& queries,
+                    size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    // Can be called once, iteration consumes the results
+    Iterator begin();
+    Iterator end();
+
+private:
+    const SearchServer& search_server_;
+    const std::vector<std::string>& queries_;
+    size_t chunk_size_;
+    size_t next_query_ = 0;
+    std::vector<Document> documents_;
+
+    // Evaluates chunks until some results are found or the queries are over
+    void LoadNextChunk();
+};
+
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
 
-std::list<Document> ProcessQueriesJoined(
+// The range would refer to the destroyed queries
+JoinedDocuments ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries); 
\ No newline at end of file
+    std::vector<std::string>&& queries) = delete;
@@ -0,0 +1,54 @@
+#include "query_cache.h"
+
+using namespace std;
+
+QueryCache::QueryCache(size_t capacity)
+    : capacity_(capacity)
+{
+}
+
+bool QueryCache::Find(const string& key, uint64_t version, vector<Document>& result) {
+    lock_guard lock(mutex_);
+    SetVersion(version);
+    const auto it = positions_.find(key);
+    if (it == positions_.end()) {
+        ++misses_;
+        return false;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    result = it->second->documents;
+    return true;
+}
+
+void QueryCache::Insert(const string& key, uint64_t version, const vector<Document>& result) {
+    if (capacity_ == 0) {
+        return;
+    }
+    lock_guard lock(mutex_);
+    SetVersion(version);
+    if (const auto it = positions_.find(key); it != positions_.end()) {
+        // Another thread has evaluated the same query meanwhile
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    entries_.push_front({key, result});
+    positions_.emplace(entries_.front().key, entries_.begin());
+    if (entries_.size() > capacity_) {
+        positions_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+QueryCache::Statistics QueryCache::GetStatistics() const {
+    lock_guard lock(mutex_);
+    return {hits_, misses_, entries_.size()};
+}
+
+void QueryCache::SetVersion(uint64_t version) {
+    if (version != version_) {
+        positions_.clear();
+        entries_.clear();
+        version_ = version;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Thread-safe LRU cache of search results.
+// Entries belong to a version of the index: the first access
+// with a newer version drops all of them
+class QueryCache {
+public:
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t size = 0;
+    };
+
+    explicit QueryCache(size_t capacity);
+
+    // Returns false if there is no result for the key in this version of the index
+    bool Find(const std::string& key, uint64_t version, std::vector<Document>& result);
+
+    void Insert(const std::string& key, uint64_t version, const std::vector<Document>& result);
+
+    Statistics GetStatistics() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<Document> documents;
+    };
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    uint64_t version_ = 0;
+    // The most recently used entries go first
+    std::list<Entry> entries_;
+    // Keys point to the strings of the entries, list nodes never move
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> positions_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    void SetVersion(uint64_t version);
+};
@@ -1,25 +1,72 @@
 #include "remove_duplicates.h"
 #include "search_server.h"
 
+#include <algorithm>
+#include <execution>
 #include <iostream>
+#include <numeric>
 
 using namespace std;
 
+namespace {
+
+// Hash of the set of term ids of a document, counts don't matter
+size_t HashTermSet(const ForwardIndex::Document& document) {
+    size_t hash = document.end - document.begin;
+    for (const auto* entry = document.begin; entry != document.end; ++entry) {
+        hash = hash * 1'000'003 ^ static_cast<size_t>(entry->term);
+    }
+    return hash;
+}
+
+// Terms of both documents are sorted, so equal sets are equal sequences
+bool HaveSameTerms(const ForwardIndex::Document& lhs, const ForwardIndex::Document& rhs) {
+    return equal(lhs.begin, lhs.end, rhs.begin, rhs.end, [](const ForwardIndex::Entry& lhs_entry, const ForwardIndex::Entry& rhs_entry) {
+        return lhs_entry.term == rhs_entry.term;
+    });
+}
+
+}  // namespace
+
+// Documents are grouped by hashes of their term id sets, which are computed in parallel.
+// Only documents with equal hashes are compared, so a hash collision never removes a document
 void RemoveDuplicates(SearchServer& search_server) {
-    vector <int> for_delete;
-    set<map<string_view,double>> filter;
-    for (const auto document_id : search_server) {
-        auto words = search_server.GetWordFrequencies(document_id);
-        for (auto& [word,frequencies] : words ) {
-            frequencies=0;
+    vector<int> document_ids(search_server.begin(), search_server.end());
+    vector<ForwardIndex::Document> documents(document_ids.size());
+    vector<size_t> hashes(document_ids.size());
+    vector<size_t> order(document_ids.size());
+    iota(order.begin(), order.end(), 0);
+    for_each(execution::par, order.begin(), order.end(), [&](size_t i) {
+        documents[i] = search_server.GetDocumentTerms(document_ids[i]);
+        hashes[i] = HashTermSet(documents[i]);
+    });
+
+    // Within a group of equal hashes documents go in the order of ids, the first of equal ones is kept
+    sort(order.begin(), order.end(), [&hashes](size_t lhs, size_t rhs) {
+        return make_pair(hashes[lhs], lhs) < make_pair(hashes[rhs], rhs);
+    });
+    vector<int> for_delete;
+    vector<size_t> originals;
+    for (size_t begin = 0, end = 0; begin < order.size(); begin = end) {
+        while (end < order.size() && hashes[order[end]] == hashes[order[begin]]) {
+            ++end;
         }
-        auto [element,unique] = filter.emplace(words);
-        if (!unique) {
-            for_delete.push_back(document_id);    
+        originals.clear();
+        for (size_t i = begin; i < end; ++i) {
+            const bool is_duplicate = any_of(originals.begin(), originals.end(), [&](size_t original) {
+                return HaveSameTerms(documents[original], documents[order[i]]);
+            });
+            if (is_duplicate) {
+                for_delete.push_back(document_ids[order[i]]);
+            } else {
+                originals.push_back(order[i]);
+            }
         }
     }
+
+    sort(for_delete.begin(), for_delete.end());
     for (const auto element : for_delete) {
         cout<<"Found duplicate document id "<<element<<endl;
-        search_server.RemoveDocument(element);
     }
-}
\ No newline at end of file
+    search_server.RemoveDocuments(for_delete);
+}
@@ -0,0 +1,29 @@
+#include "score_accumulator.h"
+
+using namespace std;
+
+ScoreAccumulator::Lease::Lease() {
+    thread_local ScoreAccumulator pooled;
+    if (pooled.leased_) {
+        own_ = make_unique<ScoreAccumulator>();
+        accumulator_ = own_.get();
+    } else {
+        accumulator_ = &pooled;
+    }
+    accumulator_->leased_ = true;
+}
+
+ScoreAccumulator::Lease::~Lease() {
+    accumulator_->Clear();
+    accumulator_->leased_ = false;
+}
+
+void ScoreAccumulator::Clear() {
+    for (const int document_id : touched_) {
+        auto& page = *pages_[document_id >> PAGE_BITS];
+        const int offset = document_id & PAGE_MASK;
+        page.scores[offset] = 0.0;
+        page.state[offset] = UNTOUCHED;
+    }
+    touched_.clear();
+}
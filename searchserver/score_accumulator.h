@@ -0,0 +1,118 @@
+#pragma once
+
+#include "document.h"
+#include "posting_list.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Per-query relevance accumulator for dense document ids.
+// Scores are kept in lazily allocated pages indexed by document id, so adding
+// a posting is an array access. Touched documents are remembered, which makes
+// clearing proportional to the number of scored documents
+class ScoreAccumulator {
+public:
+    // Borrows the accumulator of the current thread and clears it on destruction.
+    // Nested leases on the same thread get a private accumulator
+    class Lease {
+    public:
+        Lease();
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        ScoreAccumulator& operator*() const {
+            return *accumulator_;
+        }
+
+        ScoreAccumulator* operator->() const {
+            return accumulator_;
+        }
+
+    private:
+        std::unique_ptr<ScoreAccumulator> own_;
+        ScoreAccumulator* accumulator_;
+    };
+
+    void Add(int document_id, double value) {
+        auto& page = GetPage(document_id);
+        const int offset = document_id & PAGE_MASK;
+        if (page.state[offset] == UNTOUCHED) {
+            page.state[offset] = SCORED;
+            touched_.push_back(document_id);
+        }
+        page.scores[offset] += value;
+    }
+
+    template <typename Callback>
+    void ForEach(Callback callback) const {
+        for (const int document_id : touched_) {
+            const auto& page = *pages_[document_id >> PAGE_BITS];
+            const int offset = document_id & PAGE_MASK;
+            callback(document_id, page.scores[offset]);
+        }
+    }
+
+    void Clear();
+
+    // Scratch arrays for decoded postings, reused between queries
+    struct Buffers {
+        std::vector<int> document_ids;
+        std::vector<int> counts;
+        std::vector<int> excluded;
+        std::vector<int> candidates;
+        std::vector<int> temporary;
+        // Word positions of a document checked by a phrase or proximity query
+        std::vector<int> positions;
+        std::vector<int> other_positions;
+
+        // State of a pruned evaluation, so executing a query allocates only its result
+        struct TermCursor {
+            PostingList::Iterator it;
+            PostingList::Iterator end;
+            // Position of the term in the query
+            size_t order;
+            double inverse_document_freq;
+            double upper_bound;
+        };
+        std::vector<TermCursor> cursors;
+        std::vector<double> bound_sums;
+        std::vector<double> top_relevances;
+        std::vector<std::pair<size_t, double>> term_scores;
+        std::vector<Document> matched_documents;
+    };
+
+    Buffers buffers;
+
+private:
+    static const int PAGE_BITS = 12;
+    static const int PAGE_SIZE = 1 << PAGE_BITS;
+    static const int PAGE_MASK = PAGE_SIZE - 1;
+
+    enum State : uint8_t {
+        UNTOUCHED,
+        SCORED,
+    };
+
+    struct Page {
+        double scores[PAGE_SIZE] = {};
+        uint8_t state[PAGE_SIZE] = {};
+    };
+
+    std::vector<std::unique_ptr<Page>> pages_;
+    std::vector<int> touched_;
+    bool leased_ = false;
+
+    Page& GetPage(int document_id) {
+        const size_t page = document_id >> PAGE_BITS;
+        if (page >= pages_.size()) {
+            pages_.resize(page + 1);
+        }
+        if (!pages_[page]) {
+            pages_[page] = std::make_unique<Page>();
+        }
+        return *pages_[page];
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "document_store.h"
+#include "inverted_index.h"
+
+#include <cmath>
+
+enum class RankingModel {
+    TF_IDF,
+    BM25,
+};
+
+// Scorers weight a term of a document as GetTermFreq(count, norm) * IDF.
+// The norm depends only on the document, it is computed once per scored document,
+// so scoring a posting is plain arithmetic without branches.
+// GetUpperBound limits the weight of a term over all documents, for the pruned evaluation
+
+// tf is the share of the term among the words of the document
+class TfIdfScorer {
+public:
+    double GetDocumentNorm(const DocumentStore& documents, int document_id) const {
+        return documents.GetInvWordCount(document_id);
+    }
+
+    double GetTermFreq(int count, double document_norm) const {
+        return count * document_norm;
+    }
+
+    double GetUpperBound(const InvertedIndex::TermStatistics& statistics, double inverse_document_freq) const {
+        return statistics.max_term_freq * inverse_document_freq;
+    }
+};
+
+// Okapi BM25. Lengths are normalized by the average length over the corpus, which changes
+// with every document, so the stored length is turned into the norm by the per-query factors
+class Bm25Scorer {
+public:
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    explicit Bm25Scorer(double average_word_count)
+        : norm_base_(K1 * (1.0 - B))
+        , norm_scale_(average_word_count > 0.0 ? K1 * B / average_word_count : 0.0)
+    {
+    }
+
+    double GetDocumentNorm(const DocumentStore& documents, int document_id) const {
+        return norm_base_ + norm_scale_ * documents.GetWordCount(document_id);
+    }
+
+    double GetTermFreq(int count, double document_norm) const {
+        return count * (K1 + 1.0) / (count + document_norm);
+    }
+
+    // The term frequency part approaches K1 + 1 for large counts
+    double GetUpperBound(const InvertedIndex::TermStatistics&, double inverse_document_freq) const {
+        return (K1 + 1.0) * inverse_document_freq;
+    }
+
+    // Unlike the classic BM25 IDF, always positive since document_freq never exceeds
+    // document_count. The pruned evaluation relies on it: its bounds assume nonnegative scores
+    static double ComputeInverseDocumentFreq(double document_count, double document_freq) {
+        return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+private:
+    double norm_base_;
+    double norm_scale_;
+};
@@ -1,7 +1,12 @@
 #include "log_duration.h"
+#include "parallel_for.h"
 #include "search_server.h"
 
+#include <atomic>
+#include <charconv>
 #include <cmath>
+#include <cstdlib>
+#include <thread>
 
 using namespace std;
 
@@ -11,42 +16,258 @@ SearchServer::SearchServer(const string& stop_words_text)
 {
 }
 
+SearchServer::SearchServer(const SearchServer& other)
+    : stop_words_(other.stop_words_)
+    , ranking_model_(other.ranking_model_)
+{
+    if (other.position_index_) {
+        EnablePositionIndex();
+    }
+    AddDocuments(other.GetRawDocuments());
+}
+
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || (documents_.Contains(document_id))) {
         throw invalid_argument("Invalid document_id"s);
     }
-    string str;
-    for (const auto& c : document) {
-        str.push_back(c);
-    }
-    documents_strings_[document_id]=str;
-    const auto words = SplitIntoWordViewsNoStop(documents_strings_[document_id]);
+    // Text of a rejected document stays in the arena unused
+    const auto text = texts_.Store(document);
+    const auto words = SplitIntoWordViewsNoStop(text);
 
     const double inv_word_count = 1.0 / words.size();
+    map<InvertedIndex::TermId, int> term_counts;
     for (const auto& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_word_freq_[document_id][word] += inv_word_count;
+        ++term_counts[index_.AddTerm(word)];
+    }
+    vector<ForwardIndex::Entry> entries;
+    entries.reserve(term_counts.size());
+    for (const auto [term, count] : term_counts) {
+        entries.push_back({term, count});
+        index_.AddPosting(term, document_id, count, count * inv_word_count);
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+    forward_index_.AddDocument(document_id, entries.data(), entries.size());
+    if (position_index_) {
+        position_index_->AddDocument(document_id, GetWordTerms(text));
+    }
+    documents_.Add(document_id, status, ComputeAverageRating(ratings), static_cast<int>(words.size()), text);
+    word_count_ += words.size();
     document_ids_.emplace(document_id);
+    ++index_version_;
 }
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+void SearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    vector<const RawDocument*> sorted_documents;
+    sorted_documents.reserve(documents.size());
+    for (const auto& document : documents) {
+        sorted_documents.push_back(&document);
+    }
+    sort(sorted_documents.begin(), sorted_documents.end(), [](const RawDocument* lhs, const RawDocument* rhs) {
+        return lhs->id < rhs->id;
     });
-}
+    for (size_t i = 0; i < sorted_documents.size(); ++i) {
+        const int document_id = sorted_documents[i]->id;
+        if (document_id < 0 || documents_.Contains(document_id) || (i > 0 && sorted_documents[i - 1]->id == document_id)) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+    }
 
-std::vector<Document> SearchServer::FindTopDocuments( std::execution::sequenced_policy seq, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(seq,raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+    // Tokenization: every part of the batch is processed independently
+    const size_t part_count = min<size_t>(GetWorkerRangeCount(), sorted_documents.size());
+    vector<PartialIndex> parts(part_count);
+    ForEachIndexParallel(part_count, [&](size_t part) {
+        parts[part] = BuildPartialIndex(sorted_documents,
+                                        sorted_documents.size() * part / part_count,
+                                        sorted_documents.size() * (part + 1) / part_count);
     });
-}
 
-std::vector<Document> SearchServer::FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(par,raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+    // Interning is sequential, then every posting list is extended by a single worker
+    map<InvertedIndex::TermId, vector<const vector<PartialPosting>*>> term_parts;
+    for (const auto& part : parts) {
+        for (const auto& [word, postings] : part.postings) {
+            term_parts[index_.AddTerm(word)].push_back(&postings);
+        }
+    }
+    for_each(execution::par, term_parts.begin(), term_parts.end(), [this](const auto& term_postings) {
+        for (const auto* postings : term_postings.second) {
+            for (const auto posting : *postings) {
+                index_.AddPosting(term_postings.first, posting.document_id, posting.count, posting.term_freq);
+            }
+        }
     });
+
+    if (position_index_) {
+        // All words are interned by now, so the terms are looked up in parallel
+        vector<vector<InvertedIndex::TermId>> document_terms(sorted_documents.size());
+        transform(execution::par, sorted_documents.begin(), sorted_documents.end(), document_terms.begin(),
+            [this](const RawDocument* document) {
+                return GetWordTerms(document->text);
+            });
+        for (size_t i = 0; i < sorted_documents.size(); ++i) {
+            position_index_->AddDocument(sorted_documents[i]->id, document_terms[i]);
+        }
+    }
+
+    size_t entry_count = 0;
+    for (const auto& part : parts) {
+        for (const auto& word_counts : part.word_counts) {
+            entry_count += word_counts.size();
+        }
+    }
+    forward_index_.Reserve(entry_count);
+
+    size_t document_index = 0;
+    vector<ForwardIndex::Entry> entries;
+    for (const auto& part : parts) {
+        for (size_t i = 0; i < part.word_counts.size(); ++i, ++document_index) {
+            const auto& document = *sorted_documents[document_index];
+            const auto text = texts_.Store(document.text);
+            const int word_count = part.document_word_counts[i];
+            entries.clear();
+            for (const auto& [word, count] : part.word_counts[i]) {
+                entries.push_back({index_.FindTerm(word), count});
+            }
+            sort(entries.begin(), entries.end(), [](const ForwardIndex::Entry& lhs, const ForwardIndex::Entry& rhs) {
+                return lhs.term < rhs.term;
+            });
+            forward_index_.AddDocument(document.id, entries.data(), entries.size());
+            documents_.Add(document.id, document.status, ComputeAverageRating(document.ratings), word_count, text);
+            word_count_ += word_count;
+            document_ids_.emplace(document.id);
+        }
+    }
+    ++index_version_;
+}
+
+SearchServer::PartialIndex SearchServer::BuildPartialIndex(const vector<const RawDocument*>& documents, size_t first, size_t last) const {
+    PartialIndex result;
+    result.word_counts.reserve(last - first);
+    result.document_word_counts.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+        auto words = SplitIntoWordViewsNoStop(documents[i]->text);
+        const double inv_word_count = 1.0 / words.size();
+        sort(words.begin(), words.end());
+        auto& word_counts = result.word_counts.emplace_back();
+        for (size_t begin = 0, end = 0; begin < words.size(); begin = end) {
+            while (end < words.size() && words[end] == words[begin]) {
+                ++end;
+            }
+            const int count = static_cast<int>(end - begin);
+            word_counts.emplace_back(words[begin], count);
+            result.postings[words[begin]].push_back({documents[i]->id, count, count * inv_word_count});
+        }
+        result.document_word_counts.push_back(static_cast<int>(words.size()));
+    }
+    return result;
+}
+
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsByStatus(execution::seq, raw_query, status, top_k);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments( std::execution::sequenced_policy seq, std::string_view raw_query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsByStatus(seq, raw_query, status, top_k);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsByStatus(par, raw_query, status, top_k);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments( std::string_view raw_query, DocumentStatus status, size_t top_k,
+                                                      const CorpusStatistics& statistics, RankingModel ranking_model) const {
+    return FindTopDocumentsPruned(ResolveQuery(ParseQuery(raw_query), &statistics, ranking_model), StatusFilter{status}, top_k);
+}
+
+// Results for statuses are cached: unlike arbitrary predicates, a status can be a part of the key
+template <typename ExecutionPolicy>
+vector<Document> SearchServer::FindTopDocumentsByStatus(ExecutionPolicy, string_view raw_query, DocumentStatus status, size_t top_k) const {
+    const auto query = ParseQuery(raw_query);
+    const auto evaluate = [&]() {
+        const StatusFilter document_predicate{status};
+        if constexpr (is_same_v<ExecutionPolicy, execution::parallel_policy>) {
+            return FindTopDocumentsParallel(ResolveQuery(query), document_predicate, top_k);
+        } else {
+            return FindTopDocumentsPruned(ResolveQuery(query), document_predicate, top_k);
+        }
+    };
+    if (!result_cache_) {
+        return evaluate();
+    }
+    const auto key = MakeResultCacheKey(query, status, top_k);
+    vector<Document> result;
+    if (!result_cache_->Find(key, index_version_, result)) {
+        result = evaluate();
+        result_cache_->Insert(key, index_version_, result);
+    }
+    return result;
+}
+
+// Word lists of a parsed query are sorted, so equivalent queries get the same key.
+// Query words never start with '+' or '-', which makes the marks unambiguous
+string SearchServer::MakeResultCacheKey(const Query& query, DocumentStatus status, size_t top_k) {
+    string key = to_string(static_cast<int>(status)) + ' ' + to_string(top_k);
+    for (const auto word : query.plus_words) {
+        key += ' ';
+        key += word;
+    }
+    for (const auto word : query.required_words) {
+        key += " +"s;
+        key += word;
+    }
+    for (const auto word : query.minus_words) {
+        key += " -"s;
+        key += word;
+    }
+    for (const auto& phrase : query.phrases) {
+        key += " \""s;
+        for (const auto [word, position] : phrase) {
+            key += word;
+            key += '/';
+            key += to_string(position);
+            key += ' ';
+        }
+        key += '"';
+    }
+    for (const auto& [lhs, rhs, max_distance] : query.proximities) {
+        key += " NEAR/"s + to_string(max_distance) + ' ';
+        key += lhs;
+        key += ' ';
+        key += rhs;
+    }
+    return key;
+}
+
+void SearchServer::EnableResultCache(size_t capacity) {
+    result_cache_ = capacity > 0 ? make_unique<QueryCache>(capacity) : nullptr;
+}
+
+QueryCache::Statistics SearchServer::GetResultCacheStatistics() const {
+    return result_cache_ ? result_cache_->GetStatistics() : QueryCache::Statistics{};
+}
+
+void SearchServer::SetRankingModel(RankingModel model) {
+    ranking_model_ = model;
+    ++index_version_;
+}
+
+void SearchServer::EnablePositionIndex() {
+    if (GetDocumentCount() > 0) {
+        throw logic_error("The position index must be enabled before documents are added"s);
+    }
+    if (!position_index_) {
+        position_index_ = make_unique<PositionIndex>();
+    }
+}
+
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsPruned(GetResolvedQuery(query), StatusFilter{status}, top_k);
+}
+
+vector<Document> SearchServer::FindTopDocuments(execution::sequenced_policy, const PreparedQuery& query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsPruned(GetResolvedQuery(query), StatusFilter{status}, top_k);
+}
+
+vector<Document> SearchServer::FindTopDocuments(execution::parallel_policy, const PreparedQuery& query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsParallel(GetResolvedQuery(query), StatusFilter{status}, top_k);
 }
 
 vector<Document> SearchServer::FindTopDocuments( string_view raw_query) const {
@@ -61,10 +282,147 @@ std::vector<Document> SearchServer::FindTopDocuments( std::execution::parallel_p
     return SearchServer::FindTopDocuments(par, raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const vector<string>& raw_queries, DocumentStatus status, size_t top_k) const {
+    const size_t range_count = min<size_t>(GetWorkerRangeCount(), raw_queries.size());
+    const auto for_each_range = [&](auto action) {
+        ForEachIndexParallel(range_count, [&](size_t range) {
+            action(raw_queries.size() * range / range_count, raw_queries.size() * (range + 1) / range_count);
+        });
+    };
+
+    vector<ResolvedQuery> queries(raw_queries.size());
+    for_each_range([&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            queries[i] = ResolveQuery(ParseQuery(raw_queries[i]));
+        }
+    });
+
+    // Postings of every term of the batch with the documents of the given status,
+    // scores of a term differ between queries only by IDF
+    struct DecodedTerm {
+        InvertedIndex::TermId term;
+        vector<int> document_ids;
+        vector<double> term_freqs;
+    };
+    vector<DecodedTerm> decoded_terms;
+    vector<int> term_slots(index_.GetTermCount(), -1);
+    for (const auto& query : queries) {
+        for (const auto& plus_term : query.plus_terms) {
+            if (term_slots[plus_term.term] < 0) {
+                term_slots[plus_term.term] = static_cast<int>(decoded_terms.size());
+                decoded_terms.push_back({plus_term.term, {}, {}});
+            }
+        }
+    }
+    const auto decode_terms = [&](const auto& scorer) {
+        for_each(execution::par, decoded_terms.begin(), decoded_terms.end(), [&](DecodedTerm& decoded) {
+            const auto& postings = index_.GetPostings(decoded.term);
+            decoded.document_ids.reserve(postings.size());
+            decoded.term_freqs.reserve(postings.size());
+            for (const auto posting : postings) {
+                if (documents_.HasStatus(posting.document_id, status)) {
+                    decoded.document_ids.push_back(posting.document_id);
+                    decoded.term_freqs.push_back(scorer.GetTermFreq(posting.count, scorer.GetDocumentNorm(documents_, posting.document_id)));
+                }
+            }
+        });
+    };
+    if (ranking_model_ == RankingModel::BM25) {
+        decode_terms(Bm25Scorer(GetAverageWordCount()));
+    } else {
+        decode_terms(TfIdfScorer());
+    }
+
+    vector<vector<Document>> result(raw_queries.size());
+    for_each_range([&](size_t first, size_t last) {
+        ScoreAccumulator::Lease document_to_relevance;
+        auto& buffers = document_to_relevance->buffers;
+        vector<pair<double, int>> relevances;
+        for (size_t i = first; i < last; ++i) {
+            const auto& query = queries[i];
+            if (query.matches_nothing) {
+                continue;
+            }
+            // Plus terms are added in the query order, so relevances are equal to FindTopDocuments bitwise
+            for (const auto [term, inverse_document_freq] : query.plus_terms) {
+                const auto& decoded = decoded_terms[term_slots[term]];
+                for (size_t j = 0; j < decoded.document_ids.size(); ++j) {
+                    document_to_relevance->Add(decoded.document_ids[j], decoded.term_freqs[j] * inverse_document_freq);
+                }
+            }
+            DecodeQueryFilters(query, 0, DOCUMENT_ID_END, buffers);
+            const bool has_required_terms = !query.required_terms.empty();
+            const bool has_position_constraints = !query.phrases.empty() || !query.proximities.empty();
+            relevances.clear();
+            document_to_relevance->ForEach([&](int document_id, double relevance) {
+                if (!binary_search(buffers.excluded.begin(), buffers.excluded.end(), document_id)
+                    && (!has_required_terms || binary_search(buffers.candidates.begin(), buffers.candidates.end(), document_id))
+                    && (!has_position_constraints || MatchesPositions(query, document_id, buffers))) {
+                    relevances.emplace_back(relevance, document_id);
+                }
+            });
+            document_to_relevance->Clear();
+
+            // Documents more than RELEVANCE_EPSILON below the k-th relevance can't get into
+            // the top, ratings are looked up only for the rest
+            double threshold = numeric_limits<double>::lowest();
+            if (relevances.size() > top_k && top_k > 0) {
+                nth_element(relevances.begin(), relevances.begin() + (top_k - 1), relevances.end(), greater<>());
+                threshold = relevances[top_k - 1].first - RELEVANCE_EPSILON;
+            }
+            auto& matched_documents = result[i];
+            for (const auto& [relevance, document_id] : relevances) {
+                if (relevance >= threshold) {
+                    matched_documents.push_back({document_id, relevance, documents_.GetRating(document_id)});
+                }
+            }
+            SelectTopDocuments(matched_documents, top_k);
+        }
+    });
+    return result;
+}
+
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
+SearchServer::IndexStatistics SearchServer::GetIndexStatistics() const {
+    return {index_.GetTermCount(), index_.GetPostingCount(), index_.GetPostingBytes(),
+            position_index_ ? position_index_->GetByteSize() : 0, forward_index_.GetByteSize()};
+}
+
+int SearchServer::GetDocumentFrequency(string_view word) const {
+    const auto term = index_.FindTerm(word);
+    return term == InvertedIndex::NO_TERM ? 0 : static_cast<int>(index_.GetPostings(term).size());
+}
+
+void SearchServer::CollectStatistics(string_view raw_query, CorpusStatistics& statistics) const {
+    statistics.document_count += GetDocumentCount();
+    statistics.word_count += word_count_;
+    for (const auto word : ParseQuery(raw_query).plus_words) {
+        statistics.document_freqs[word] += GetDocumentFrequency(word);
+    }
+}
+
+bool SearchServer::HasDocument(int document_id) const {
+    return documents_.Contains(document_id);
+}
+
+int SearchServer::GetDocumentLength(int document_id) const {
+    return documents_.Contains(document_id) ? documents_.GetWordCount(document_id) : 0;
+}
+
+vector<RawDocument> SearchServer::GetRawDocuments() const {
+    vector<RawDocument> documents;
+    documents.reserve(documents_.size());
+    for (const int document_id : document_ids_) {
+        // The average of a single rating is the rating itself
+        documents.push_back({document_id, documents_.GetText(document_id), documents_.GetStatus(document_id),
+                             {documents_.GetRating(document_id)}});
+    }
+    return documents;
+}
+
 std::set<int>::iterator SearchServer::begin() {
     return document_ids_.begin();
 }
@@ -73,29 +431,26 @@ std::set<int>::iterator SearchServer::end () {
     return document_ids_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id)  const{
+ForwardIndex::Document SearchServer::GetDocumentTerms(int document_id) const {
+    return forward_index_.GetDocument(document_id);
+}
+
+WordFrequencies SearchServer::GetWordFrequencies(int document_id)  const{
     
-    auto answer = document_word_freq_.find(document_id);
-    if (answer!=document_word_freq_.end()) {
-        return answer ->second;
+    if (documents_.Contains(document_id)) {
+        return WordFrequencies(index_, forward_index_.GetDocument(document_id), documents_.GetInvWordCount(document_id));
     } else {
-        static map<string_view, double> empty;
-        return empty;
+        return {};
     }
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    auto erase=documents_.erase(document_id);
-    if (erase) {
-        for (auto [word,freq] : document_word_freq_.at(document_id)) {
-            if (word_to_document_freqs_[word].size()==1) {
-                word_to_document_freqs_.erase(word);
-            } else {
-                word_to_document_freqs_[word].erase(document_id);
-            }
+    if (documents_.Contains(document_id)) {
+        const auto document = forward_index_.GetDocument(document_id);
+        for (const auto* entry = document.begin; entry != document.end; ++entry) {
+            index_.RemovePosting(entry->term, document_id);
         }
-        document_word_freq_.erase(document_id);
-        document_ids_.erase(document_id);       
+        EraseDocumentData(document_id);
     }
 }
 
@@ -104,52 +459,60 @@ void SearchServer::RemoveDocument( std::execution::sequenced_policy seq, int doc
 }
 
 void SearchServer::RemoveDocument( std::execution::parallel_policy par, int document_id) {
-    auto erase=documents_.erase(document_id);
-    if (erase) {
-        vector <string> s(document_word_freq_.at(document_id).size());
-        int i=0;
-        for (auto [word,freq] : document_word_freq_.at(document_id)) {
-            s[i]=word;
-            ++i;
+    if (documents_.Contains(document_id)) {
+        const auto document = forward_index_.GetDocument(document_id);
+        vector<InvertedIndex::TermId> terms;
+        terms.reserve(document.end - document.begin);
+        for (const auto* entry = document.begin; entry != document.end; ++entry) {
+            terms.push_back(entry->term);
         }
-        auto erase = [this,document_id](const auto& word ) { 
-            if (word_to_document_freqs_[word].size()==1) {
-                word_to_document_freqs_.erase(word);
-                    
-            }
-            word_to_document_freqs_[word].erase(document_id);
+        // Every term owns a separate posting list, so the lists can be updated concurrently
+        auto erase = [this,document_id](InvertedIndex::TermId term) {
+            index_.RemovePosting(term, document_id);
         };  
-        for_each(execution::par, s.begin(), s.end(),erase);
-        document_word_freq_.erase(document_id);
-        document_ids_.erase(document_id);
+        for_each(execution::par, terms.begin(), terms.end(),erase);
+        EraseDocumentData(document_id);
     }           
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument( string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
-    vector<string_view> matched_words;
-    bool clear=false;
-    for (const auto& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    map<InvertedIndex::TermId, vector<int>> term_documents;
+    vector<int> removed_ids;
+    for (const int document_id : document_ids) {
+        if (!documents_.Contains(document_id)) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.clear();
-            clear=true;
-            break;
+        removed_ids.push_back(document_id);
+        const auto document = forward_index_.GetDocument(document_id);
+        for (const auto* entry = document.begin; entry != document.end; ++entry) {
+            term_documents[entry->term].push_back(document_id);
         }
     }
-    if (!clear) {
-        for (const auto& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.push_back(word);
-            }
+    for_each(execution::par, term_documents.begin(), term_documents.end(), [this](const auto& term_ids) {
+        for (const int document_id : term_ids.second) {
+            index_.RemovePosting(term_ids.first, document_id);
         }
+    });
+    for (const int document_id : removed_ids) {
+        EraseDocumentData(document_id);
     }
-    return {matched_words, documents_.at(document_id).status};
+}
+
+void SearchServer::EraseDocumentData(int document_id) {
+    forward_index_.RemoveDocument(document_id);
+    document_ids_.erase(document_id);
+    word_count_ -= documents_.GetWordCount(document_id);
+    documents_.Remove(document_id);
+    if (position_index_) {
+        position_index_->RemoveDocument(document_id);
+    }
+    ++index_version_;
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument( string_view raw_query, int document_id) const {
+    vector<string_view> matched_words;
+    const auto status = MatchDocument(ResolvePreparedQuery(raw_query), document_id, matched_words);
+    return {matched_words, status};
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&,  std::string_view raw_query, int document_id) const {
@@ -157,38 +520,109 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&,  std::string_view raw_query, int document_id) const {
+    if (!documents_.Contains(document_id)) {
+        throw out_of_range("Invalid document_id"s);
+    }
     const auto query = ParseQuery(raw_query);
-    vector<string_view> matched_words;
-    auto match= [this,&document_id,&matched_words](auto& word){
-        if (word_to_document_freqs_.count(word) != 0) {
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
-            }
-        }
+    const auto status = documents_.GetStatus(document_id);
+    const auto contains = [this, document_id](string_view word) {
+        const auto term = index_.FindTerm(word);
+        return term != InvertedIndex::NO_TERM && index_.GetPostings(term).Contains(document_id);
     };
-    bool clear=false;
-    auto match_clear=[this,&document_id,&matched_words,&clear](auto& word){
-        if (!clear && word_to_document_freqs_.count(word) != 0) {
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.clear();
-            clear=true;
-            }
+    if (any_of(execution::par, query.minus_words.begin(), query.minus_words.end(), contains)
+        || !all_of(query.required_words.begin(), query.required_words.end(), contains)) {
+        return {vector<string_view>{}, status};
+    }
+    if (!query.phrases.empty() || !query.proximities.empty()) {
+        ScoreAccumulator::Lease lease;
+        if (!MatchesPositions(ResolveQuery(query), document_id, lease->buffers)) {
+            return {vector<string_view>{}, status};
         }
-    };
-    for_each(execution::par, query.minus_words.begin(), query.minus_words.end(),match_clear);
-    if (!clear) {
-        for_each(execution::par, query.plus_words.begin(), query.plus_words.end(),match);
+    }
+    // Every worker writes only its own slot, the order of words is kept
+    vector<string_view> matched_words(query.plus_words.size());
+    const auto matched_end = copy_if(execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), contains);
+    matched_words.erase(matched_end, matched_words.end());
+    return {matched_words, status};
+}
 
+SearchServer::PreparedQuery SearchServer::PrepareQuery(string_view raw_query) const {
+    PreparedQuery prepared_query = ResolvePreparedQuery(raw_query);
+    auto& query = prepared_query.query_;
+    if (!query.matches_nothing) {
+        ScoreAccumulator::Lease lease;
+        auto& buffers = lease->buffers;
+        DecodeQueryFilters(query, 0, DOCUMENT_ID_END, buffers);
+        query.excluded_documents = buffers.excluded;
+        if (!query.required_terms.empty()) {
+            query.candidate_documents = buffers.candidates;
+        }
+        query.has_decoded_filters = true;
     }
-    return {matched_words, documents_.at(document_id).status};
+    return prepared_query;
 }
 
-bool SearchServer::IsStopWord( string_view word) const {
-    string str;
-    for (auto c : word) {
-        str.push_back(c);
+SearchServer::PreparedQuery SearchServer::ResolvePreparedQuery(string_view raw_query) const {
+    PreparedQuery prepared_query;
+    prepared_query.query_ = ResolveQuery(ParseQuery(raw_query));
+    prepared_query.server_id_ = server_id_;
+    prepared_query.index_version_ = index_version_;
+    return prepared_query;
+}
+
+uint64_t SearchServer::MakeServerId() {
+    static atomic<uint64_t> next_server_id = 1;
+    return next_server_id++;
+}
+
+const SearchServer::ResolvedQuery& SearchServer::GetResolvedQuery(const PreparedQuery& query) const {
+    if (query.server_id_ != server_id_) {
+        throw logic_error("The query was prepared by another server"s);
+    }
+    if (query.index_version_ != index_version_) {
+        throw logic_error("The query was prepared before the last modification of the server"s);
     }
-    return stop_words_.count(str) > 0;
+    return query.query_;
+}
+
+DocumentStatus SearchServer::MatchDocument(const PreparedQuery& prepared_query, int document_id, vector<string_view>& matched_words) const {
+    if (!documents_.Contains(document_id)) {
+        throw out_of_range("Invalid document_id"s);
+    }
+    if (prepared_query.server_id_ != server_id_) {
+        throw logic_error("The query was prepared by another server"s);
+    }
+    matched_words.clear();
+    const auto& query = prepared_query.query_;
+    const auto status = documents_.GetStatus(document_id);
+    if (query.matches_nothing) {
+        return status;
+    }
+    const auto document = forward_index_.GetDocument(document_id);
+    const auto contains = [&document](InvertedIndex::TermId term) {
+        return document.Contains(term);
+    };
+    if (any_of(query.minus_terms.begin(), query.minus_terms.end(), contains)
+        || !all_of(query.required_terms.begin(), query.required_terms.end(), contains)) {
+        return status;
+    }
+    if (!query.phrases.empty() || !query.proximities.empty()) {
+        ScoreAccumulator::Lease lease;
+        if (!MatchesPositions(query, document_id, lease->buffers)) {
+            return status;
+        }
+    }
+    for (const auto& plus_term : query.plus_terms) {
+        if (contains(plus_term.term)) {
+            matched_words.push_back(index_.GetTerm(plus_term.term));
+        }
+    }
+    return status;
+}
+
+bool SearchServer::IsStopWord( string_view word) const {
+    // Transparent comparison, no temporary string is built
+    return stop_words_.count(word) > 0;
 }
 
 bool SearchServer::IsValidWord(string_view word) {
@@ -211,15 +645,17 @@ vector<string> SearchServer::SplitIntoWordsNoStop(const string& text) const {
     return words;
 }
 vector<string_view> SearchServer::SplitIntoWordViewsNoStop( string_view text) const {
+    // Words are checked one by one only to find the invalid one
+    const bool has_invalid_words = HasControlCharacters(text);
     vector<string_view> words;
-    for (const auto& word : SplitIntoWordsView(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word "s + word.data() + " is invalid"s);
+    ForEachWordView(text, [&](string_view word) {
+        if (has_invalid_words && !IsValidWord(word)) {
+            throw invalid_argument("Word "s + string(word) + " is invalid"s);
         }
         if (!IsStopWord(word)) {
             words.push_back(word);
         }
-    }
+    });
     return words;
 }
 
@@ -240,35 +676,264 @@ SearchServer::QueryWord SearchServer::ParseQueryWord( string_view text) const {
     }
     auto word = text;
     bool is_minus = false;
+    bool is_required = false;
     if (word[0] == '-') {
         is_minus = true;
         word = word.substr(1);
+    } else if (word[0] == '+') {
+        is_required = true;
+        word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw invalid_argument("Query word "s + text.data() + " is invalid");
+    if (word.empty() || word[0] == '-' || word[0] == '+' || !IsValidWord(word)) {
+        throw invalid_argument("Query word "s + string(text) + " is invalid");
     }
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, is_required, IsStopWord(word)};
 }
 
 
 SearchServer::Query SearchServer::ParseQuery( string_view text) const {
     Query result;
-    for (const auto& word : SplitIntoWordsView(text)) {
-        const auto query_word = ParseQueryWord(word);
+    const auto words = SplitIntoWordsView(text);
+    // The preceding plus word, the left operand of NEAR/k
+    string_view operand;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (!words[i].empty() && words[i][0] == '"') {
+            i = ParsePhrase(words, i, result);
+            operand = {};
+            continue;
+        }
+        if (const int max_distance = ParseProximityOperator(words[i]); max_distance > 0) {
+            // Operands are single words, not phrases or other operators
+            const bool has_rhs = i + 1 < words.size() && !words[i + 1].empty() && words[i + 1][0] != '"'
+                && ParseProximityOperator(words[i + 1]) == 0;
+            const auto rhs = has_rhs ? ParseQueryWord(words[i + 1]) : QueryWord{};
+            if (operand.empty() || !has_rhs || rhs.is_minus || rhs.is_stop) {
+                throw invalid_argument("Operator "s + string(words[i]) + " needs a plus word on each side"s);
+            }
+            ++i;
+            result.plus_words.push_back(rhs.data);
+            result.required_words.push_back(operand);
+            result.required_words.push_back(rhs.data);
+            result.proximities.push_back({operand, rhs.data, max_distance});
+            operand = rhs.data;
+            continue;
+        }
+        const auto query_word = ParseQueryWord(words[i]);
+        operand = {};
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
-                result.minus_words.insert(query_word.data);
+                result.minus_words.push_back(query_word.data);
             } else {
-                result.plus_words.insert(query_word.data);
+                result.plus_words.push_back(query_word.data);
+                if (query_word.is_required) {
+                    result.required_words.push_back(query_word.data);
+                }
+                operand = query_word.data;
             }
         }
     }
+    if (!position_index_ && (!result.phrases.empty() || !result.proximities.empty())) {
+        throw invalid_argument("Phrase and proximity queries need the position index"s);
+    }
+    RemoveDuplicateWords(result.plus_words);
+    RemoveDuplicateWords(result.minus_words);
+    RemoveDuplicateWords(result.required_words);
     return result;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq( string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+// Stop words inside a phrase match any word, positions are counted from the first word
+// that isn't a stop word. A phrase of a single word is just a required word
+size_t SearchServer::ParsePhrase(const vector<string_view>& words, size_t begin, Query& query) const {
+    vector<PhraseWord> phrase;
+    for (size_t i = begin; i < words.size(); ++i) {
+        auto word = words[i];
+        if (i == begin) {
+            word.remove_prefix(1);
+        }
+        const bool is_last = !word.empty() && word.back() == '"';
+        if (is_last) {
+            word.remove_suffix(1);
+        }
+        const auto query_word = ParseQueryWord(word);
+        if (query_word.is_minus || query_word.is_required) {
+            throw invalid_argument("Query word "s + string(words[i]) + " is invalid"s);
+        }
+        if (!query_word.is_stop) {
+            query.plus_words.push_back(query_word.data);
+            query.required_words.push_back(query_word.data);
+            phrase.push_back({query_word.data, static_cast<int>(i - begin)});
+        }
+        if (is_last) {
+            if (phrase.size() > 1) {
+                for (auto& phrase_word : phrase) {
+                    phrase_word.position -= phrase[0].position;
+                }
+                query.phrases.push_back(move(phrase));
+            }
+            return i;
+        }
+    }
+    throw invalid_argument("Phrase "s + string(words[begin]) + " isn't closed"s);
+}
+
+int SearchServer::ParseProximityOperator(string_view word) {
+    const auto prefix = "NEAR/"sv;
+    if (word.substr(0, prefix.size()) != prefix) {
+        return 0;
+    }
+    const auto digits = word.substr(prefix.size());
+    int max_distance = 0;
+    const auto [end, error] = from_chars(digits.data(), digits.data() + digits.size(), max_distance);
+    if (digits.empty() || error != errc() || end != digits.data() + digits.size() || max_distance <= 0) {
+        throw invalid_argument("Operator "s + string(word) + " is invalid"s);
+    }
+    return max_distance;
+}
+
+vector<InvertedIndex::TermId> SearchServer::GetWordTerms(string_view text) const {
+    vector<InvertedIndex::TermId> terms;
+    ForEachWordView(text, [&](string_view word) {
+        // Stop words are never added to the dictionary
+        terms.push_back(index_.FindTerm(word));
+    });
+    return terms;
+}
+
+// Phrases intersect candidate start positions word by word, proximities merge two position lists
+bool SearchServer::MatchesPositions(const ResolvedQuery& query, int document_id, ScoreAccumulator::Buffers& buffers) const {
+    auto& starts = buffers.other_positions;
+    auto& positions = buffers.positions;
+    for (const auto& phrase : query.phrases) {
+        position_index_->GetPositions(document_id, phrase[0].term, starts);
+        for (size_t i = 1; i < phrase.size() && !starts.empty(); ++i) {
+            position_index_->GetPositions(document_id, phrase[i].term, positions);
+            for (int& position : positions) {
+                position -= phrase[i].position;
+            }
+            IntersectSortedIds(starts, positions, buffers.temporary);
+            swap(starts, buffers.temporary);
+        }
+        if (starts.empty()) {
+            return false;
+        }
+    }
+    for (const auto [lhs, rhs, max_distance] : query.proximities) {
+        position_index_->GetPositions(document_id, lhs, starts);
+        position_index_->GetPositions(document_id, rhs, positions);
+        bool is_near = false;
+        for (size_t i = 0, j = 0; i < starts.size() && j < positions.size() && !is_near;) {
+            // Equal positions are the same occurrence of a word used on both sides
+            is_near = starts[i] != positions[j] && abs(starts[i] - positions[j]) <= max_distance;
+            if (starts[i] < positions[j]) {
+                ++i;
+            } else {
+                ++j;
+            }
+        }
+        if (!is_near) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SearchServer::RemoveDuplicateWords(vector<string_view>& words) {
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+}
+
+SearchServer::ResolvedQuery SearchServer::ResolveQuery(const Query& query, const CorpusStatistics* statistics,
+                                                       RankingModel ranking_model) const {
+    ResolvedQuery result;
+    result.ranking_model = ranking_model;
+    const double log_document_count = log(static_cast<double>(GetDocumentCount()));
+    for (const auto word : query.plus_words) {
+        const auto term = index_.FindTerm(word);
+        if (term == InvertedIndex::NO_TERM || index_.GetPostings(term).empty()) {
+            continue;
+        }
+        // The whole corpus may have no documents with the word, when the local ones are excluded by the caller
+        const int document_freq = statistics ? statistics->document_freqs.at(word) : 0;
+        if (statistics && document_freq == 0) {
+            continue;
+        }
+        double inverse_document_freq = 0.0;
+        if (ranking_model == RankingModel::BM25) {
+            inverse_document_freq = statistics
+                ? Bm25Scorer::ComputeInverseDocumentFreq(statistics->document_count, document_freq)
+                : Bm25Scorer::ComputeInverseDocumentFreq(GetDocumentCount(), index_.GetPostings(term).size());
+        } else {
+            inverse_document_freq = statistics
+                ? log(statistics->document_count * 1.0 / document_freq)
+                : ComputeWordInverseDocumentFreq(term, log_document_count);
+        }
+        result.plus_terms.push_back({term, inverse_document_freq});
+    }
+    result.average_word_count = !statistics ? GetAverageWordCount()
+        : statistics->document_count > 0 ? static_cast<double>(statistics->word_count) / statistics->document_count : 0.0;
+    for (const auto word : query.minus_words) {
+        const auto term = index_.FindTerm(word);
+        if (term != InvertedIndex::NO_TERM) {
+            result.minus_terms.push_back(term);
+        }
+    }
+    for (const auto word : query.required_words) {
+        const auto term = index_.FindTerm(word);
+        if (term == InvertedIndex::NO_TERM || index_.GetPostings(term).empty()) {
+            result.matches_nothing = true;
+        } else {
+            result.required_terms.push_back(term);
+        }
+    }
+    // Words of the constraints are required, so all of them are in the index
+    if (!result.matches_nothing) {
+        for (const auto& phrase : query.phrases) {
+            auto& terms = result.phrases.emplace_back();
+            for (const auto [word, position] : phrase) {
+                terms.push_back({index_.FindTerm(word), position});
+            }
+        }
+        for (const auto& [lhs, rhs, max_distance] : query.proximities) {
+            result.proximities.push_back({index_.FindTerm(lhs), index_.FindTerm(rhs), max_distance});
+        }
+    }
+    return result;
+}
+
+// Minus words and required words are applied as set operations over sorted document ids
+void SearchServer::DecodeQueryFilters(const ResolvedQuery& query, int first_document_id, int64_t last_document_id,
+                                      ScoreAccumulator::Buffers& buffers) const {
+    buffers.excluded.clear();
+    for (const auto term : query.minus_terms) {
+        index_.GetPostings(term).Decode(first_document_id, last_document_id, buffers.document_ids, buffers.counts);
+        UniteSortedIds(buffers.excluded, buffers.document_ids, buffers.temporary);
+        swap(buffers.excluded, buffers.temporary);
+    }
+    if (!query.required_terms.empty()) {
+        index_.GetPostings(query.required_terms[0]).Decode(first_document_id, last_document_id, buffers.candidates, buffers.counts);
+        for (size_t i = 1; i < query.required_terms.size() && !buffers.candidates.empty(); ++i) {
+            index_.GetPostings(query.required_terms[i]).Decode(first_document_id, last_document_id, buffers.document_ids, buffers.counts);
+            IntersectSortedIds(buffers.candidates, buffers.document_ids, buffers.temporary);
+            swap(buffers.candidates, buffers.temporary);
+        }
+        SubtractSortedIds(buffers.candidates, buffers.excluded, buffers.temporary);
+        swap(buffers.candidates, buffers.temporary);
+    }
+}
+
+// Existence required. The corpus part is computed once per query,
+// the term part is maintained by the index
+double SearchServer::ComputeWordInverseDocumentFreq(InvertedIndex::TermId term, double log_document_count) const {
+    return log_document_count - index_.GetStatistics(term).log_document_freq;
+}
+
+    
+
+double SearchServer::GetAverageWordCount() const {
+    return documents_.size() > 0 ? static_cast<double>(word_count_) / documents_.size() : 0.0;
 }
 
-    
\ No newline at end of file
+int SearchServer::GetWorkerRangeCount() {
+    // A few ranges per core let the scheduler balance unevenly filled ranges
+    return max(1u, thread::hardware_concurrency()) * 4;
+}
\ No newline at end of file
@@ -1,22 +1,56 @@
 #pragma once
 
-#include "concurrent_map.h"
 #include "document.h"
+#include "document_store.h"
+#include "forward_index.h"
+#include "inverted_index.h"
 #include "log_duration.h"
+#include "mapped_file.h"
+#include "position_index.h"
+#include "query_cache.h"
+#include "score_accumulator.h"
+#include "scorer.h"
+#include "sorted_set_operations.h"
 #include "string_processing.h"
+#include "text_arena.h"
 
 #include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <execution>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
 
 using namespace std::string_literals;
 
+// Collection statistics for IDF computation. A server that holds only a part
+// of the corpus (e.g. a shard) is given statistics of the whole corpus,
+// so its relevances are comparable with the other parts
+struct CorpusStatistics {
+    int document_count = 0;
+    // Total number of indexed words, for length normalization
+    int64_t word_count = 0;
+    std::map<std::string_view, int> document_freqs;
+};
+
+// Document for bulk indexing, the text is copied by the server
+struct RawDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 class SearchServer {
 public:
     template <typename StringContainer>
@@ -30,72 +64,78 @@ public:
 
     explicit SearchServer(const std::string& stop_words_text);
 
+    // Views of a server point to its own storage, so a copy indexes the documents anew.
+    // The copy has no result cache
+    SearchServer(const SearchServer& other);
+
+    SearchServer(SearchServer&& other) = default;
+
     void AddDocument(int document_id,  std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments( std::string_view raw_query, DocumentPredicate document_predicate) const {
-        const auto query = ParseQuery(raw_query);
-         std::vector<Document> matched_documents;
-        matched_documents = FindAllDocuments(query, document_predicate);
-        sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
+    // Indexes a batch of documents: texts are tokenized in parallel, every worker
+    // builds partial postings for its part of the batch and the parts are appended
+    // to the posting lists in one pass. Nothing is added if some document is invalid
+    void AddDocuments(const std::vector<RawDocument>& documents);
 
-        return matched_documents;
-    }
+    // Writes the whole state of the server to a file.
+    // The format uses the native byte order of the machine
+    void SaveIndex(const std::string& path) const;
+
+    // Opens a file written by SaveIndex. The file is mapped to memory: terms, postings, forward index
+    // entries, positions and texts are used in place without parsing or copying. Only the header,
+    // the dictionary, the block tables of postings and the document records are checked, so startup
+    // takes O(terms + blocks + documents); the encoded data is trusted until VerifyIndex is called
+    static SearchServer OpenIndex(const std::string& path);
+
+    // Decodes postings, forward index entries and positions, e.g. of an index opened from an untrusted file,
+    // and throws runtime_error if they are inconsistent. Takes O(size of the index)
+    void VerifyIndex() const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments( std::execution::sequenced_policy seq, std::string_view raw_query, DocumentPredicate document_predicate) const {
-        const auto query = ParseQuery(raw_query);
+    std::vector<Document> FindTopDocuments( std::string_view raw_query, DocumentPredicate document_predicate,
+                                            size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        const auto query = ResolveQuery(ParseQuery(raw_query));
 
-        auto matched_documents = FindAllDocuments(query, document_predicate);
+        return FindTopDocumentsPruned(query, document_predicate, top_k);
+    }
 
-        sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments( std::execution::sequenced_policy seq, std::string_view raw_query, DocumentPredicate document_predicate,
+                                            size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        const auto query = ResolveQuery(ParseQuery(raw_query));
 
-        return matched_documents;
+        return FindTopDocumentsPruned(query, document_predicate, top_k);
     }
     
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query, DocumentPredicate document_predicate) const {
-        const auto query = ParseQuery(raw_query);
+    std::vector<Document> FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query, DocumentPredicate document_predicate,
+                                            size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        const auto query = ResolveQuery(ParseQuery(raw_query));
 
-        auto matched_documents = FindAllDocuments(par, query, document_predicate);
+        return FindTopDocumentsParallel(query, document_predicate, top_k);
+    }
 
-        sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
+    // Ranks documents of this server using IDF of the whole corpus and the ranking model
+    // of the caller instead of the model of this server
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments( std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k,
+                                            const CorpusStatistics& statistics, RankingModel ranking_model) const {
+        const auto query = ResolveQuery(ParseQuery(raw_query), &statistics, ranking_model);
 
-        return matched_documents;
+        return FindTopDocumentsPruned(query, document_predicate, top_k);
     }
+
+    std::vector<Document> FindTopDocuments( std::string_view raw_query, DocumentStatus status, size_t top_k,
+                                            const CorpusStatistics& statistics, RankingModel ranking_model) const;
     
-    std::vector<Document> FindTopDocuments( std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments( std::string_view raw_query, DocumentStatus status,
+                                            size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments( std::execution::sequenced_policy seq, std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments( std::execution::sequenced_policy seq, std::string_view raw_query, DocumentStatus status,
+                                            size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query, DocumentStatus status,
+                                            size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document> FindTopDocuments( std::string_view raw_query) const;
 
@@ -103,15 +143,101 @@ public:
 
     std::vector<Document> FindTopDocuments( std::execution::parallel_policy par, std::string_view raw_query) const;
 
+    class PreparedQuery;
+
+    // Parses the query and resolves its words against the dictionary once.
+    // A prepared query can be executed many times while the server isn't modified
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsPruned(GetResolvedQuery(query), document_predicate, top_k);
+    }
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy seq, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsPruned(GetResolvedQuery(query), document_predicate, top_k);
+    }
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy par, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsParallel(GetResolvedQuery(query), document_predicate, top_k);
+    }
+
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy seq, const PreparedQuery& query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy par, const PreparedQuery& query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Evaluates a batch of queries term-at-a-time. Every posting list used by the batch
+    // is decoded once, together with the statuses and lengths of its documents,
+    // and then added to the accumulators of all queries containing the term.
+    // Results are the same as of FindTopDocuments for every query
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             DocumentStatus status = DocumentStatus::ACTUAL,
+                                                             size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Caches results of the queries by status, up to capacity of them.
+    // Any modification of the server invalidates the cached results, 0 disables the cache
+    void EnableResultCache(size_t capacity);
+
+    QueryCache::Statistics GetResultCacheStatistics() const;
+
+    // Keeps positions of the words, which enables phrase and proximity queries:
+    // "quoted phrase" matches documents with the words in a row, a NEAR/k b matches
+    // documents with a and b at most k words apart. Their words are required plus words.
+    // Must be called before documents are added
+    void EnablePositionIndex();
+
+    // TF-IDF unless changed. Changing the model invalidates cached results
+    void SetRankingModel(RankingModel model);
+
     int GetDocumentCount() const;
 
+    struct IndexStatistics {
+        size_t term_count = 0;
+        size_t posting_count = 0;
+        size_t posting_bytes = 0;
+        size_t position_bytes = 0;
+        size_t forward_bytes = 0;
+    };
+
+    IndexStatistics GetIndexStatistics() const;
+
+    // Number of documents containing the word
+    int GetDocumentFrequency(std::string_view word) const;
+
+    // Adds the document count and document frequencies of the query plus words
+    void CollectStatistics(std::string_view raw_query, CorpusStatistics& statistics) const;
+
     int GetDocumentId(int index) const;
 
+    bool HasDocument(int document_id) const;
+
+    // Number of indexed words of the document, stop words excluded
+    int GetDocumentLength(int document_id) const;
+
+    // Documents in the form accepted by AddDocuments, in increasing order of ids.
+    // Texts point to the storage of the server
+    std::vector<RawDocument> GetRawDocuments() const;
+
     std::set<int>::iterator begin();
     
     std::set<int>::iterator end ();
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Empty for unknown documents
+    WordFrequencies GetWordFrequencies(int document_id) const;
+
+    // Term ids of the document's words with their counts, sorted by term id. Empty for unknown documents,
+    // valid until the next modification of the server
+    ForwardIndex::Document GetDocumentTerms(int document_id) const;
 
     void RemoveDocument(int document_id);
 
@@ -119,37 +245,145 @@ public:
 
     void RemoveDocument( std::execution::parallel_policy par, int document_id);
 
+    // Removes a batch of documents, every posting list is updated once by a single worker.
+    // Unknown ids are ignored
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument( std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&,  std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&,  std::string_view raw_query, int document_id) const;
-    
+
+    // Replaces the contents of matched_words with the plus words of the query found in the document.
+    // Words are looked up in the document's own word list, the views point to the dictionary
+    // of the server. With a reused buffer nothing is allocated, concurrent calls are safe
+    DocumentStatus MatchDocument(const PreparedQuery& query, int document_id, std::vector<std::string_view>& matched_words) const;
+
 private:
-    struct DocumentData {
-        int rating;
+    // Predicate of the queries by status, evaluated with the status bitmaps of the document store
+    struct StatusFilter {
         DocumentStatus status;
     };
 
     struct QueryWord {
         std::string_view data;
         bool is_minus;
+        bool is_required;
         bool is_stop;
     };
 
+    // Word of a phrase and its position counted from the first word of the phrase
+    struct PhraseWord {
+        std::string_view word;
+        int position;
+    };
+
+    struct ProximityWords {
+        std::string_view lhs;
+        std::string_view rhs;
+        int max_distance;
+    };
+
+    // Words marked with '+' must be present in a matched document,
+    // they are scored as ordinary plus words too.
+    // Word lists are sorted and have no duplicates
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+        std::vector<std::string_view> required_words;
+        // Constraints checked with the position index, in the query order
+        std::vector<std::vector<PhraseWord>> phrases;
+        std::vector<ProximityWords> proximities;
+    };
+
+    struct WeightedTerm {
+        InvertedIndex::TermId term;
+        double inverse_document_freq;
+    };
+
+    struct PhraseTerm {
+        InvertedIndex::TermId term;
+        int position;
     };
 
-    const std::set<std::string> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    struct ProximityTerms {
+        InvertedIndex::TermId lhs;
+        InvertedIndex::TermId rhs;
+        int max_distance;
+    };
+
+    // Query words found in the index, plus words have non-empty postings
+    struct ResolvedQuery {
+        std::vector<WeightedTerm> plus_terms;
+        std::vector<InvertedIndex::TermId> minus_terms;
+        std::vector<InvertedIndex::TermId> required_terms;
+        std::vector<std::vector<PhraseTerm>> phrases;
+        std::vector<ProximityTerms> proximities;
+        // Model of the IDF above and of the scores
+        RankingModel ranking_model = RankingModel::TF_IDF;
+        // Average document length of the corpus, used by BM25
+        double average_word_count = 0.0;
+        // Filled only for prepared queries: documents having some minus word and, if there are
+        // required words, documents having all of them and no minus words. Both are sorted
+        bool has_decoded_filters = false;
+        std::vector<int> excluded_documents;
+        std::vector<int> candidate_documents;
+        // Some required word is absent from the index
+        bool matches_nothing = false;
+    };
+
+public:
+    // Query parsed and resolved by PrepareQuery: term ids with their IDF and the decoded
+    // minus and required word filters. Words are resolved against the dictionary at preparation,
+    // words added to the dictionary later aren't found by the query.
+    // Ranking with a query prepared before a modification of the server throws,
+    // matching stays valid. Using a query prepared by another server throws
+    class PreparedQuery {
+    private:
+        friend class SearchServer;
+
+        ResolvedQuery query_;
+        uint64_t server_id_ = 0;
+        uint64_t index_version_ = 0;
+    };
+
+private:
+    const std::set<std::string, std::less<>> stop_words_;
+    InvertedIndex index_;
+    DocumentStore documents_;
     //std::vector<int> document_ids_;
     std::set<int> document_ids_;
-    std::map<int,std::map<std::string_view,double>> document_word_freq_;
-    std::map<int,std::string>documents_strings_;
+    ForwardIndex forward_index_;
+    TextArena texts_;
+    // Absent unless enabled, queries without phrases never use it
+    std::unique_ptr<PositionIndex> position_index_;
+    RankingModel ranking_model_ = RankingModel::TF_IDF;
+    // Sum of the lengths of all documents
+    int64_t word_count_ = 0;
+    // Keeps postings, terms and texts of an opened index file in place
+    std::shared_ptr<const MappedFile> index_file_;
+    // Incremented by every modification
+    uint64_t index_version_ = 0;
+    // Unique among the servers of the process, a copy gets its own
+    const uint64_t server_id_ = MakeServerId();
+    std::unique_ptr<QueryCache> result_cache_;
+
+    // Postings of a part of a batch, in increasing order of document ids
+    struct PartialPosting {
+        int document_id;
+        int count;
+        double term_freq;
+    };
+
+    struct PartialIndex {
+        std::unordered_map<std::string_view, std::vector<PartialPosting>> postings;
+        std::vector<std::vector<std::pair<std::string_view, int>>> word_counts;
+        std::vector<int> document_word_counts;
+    };
 
+    PartialIndex BuildPartialIndex(const std::vector<const RawDocument*>& documents, size_t first, size_t last) const;
+    void EraseDocumentData(int document_id);
     bool IsStopWord( std::string_view word) const;
     static bool IsValidWord( std::string_view word);
     std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
@@ -157,75 +391,222 @@ private:
     static int ComputeAverageRating(const std::vector<int>& ratings);
     QueryWord ParseQueryWord(std::string_view text) const;
     Query ParseQuery( std::string_view text) const;
-    double ComputeWordInverseDocumentFreq( std::string_view word) const;
-
+    // Parses the phrase starting at words[begin], returns the position of its last word
+    size_t ParsePhrase(const std::vector<std::string_view>& words, size_t begin, Query& query) const;
+    // Returns k of a NEAR/k operator, 0 for an ordinary word
+    static int ParseProximityOperator(std::string_view word);
+    // Terms of the words of the text in order, NO_TERM for stop words
+    std::vector<InvertedIndex::TermId> GetWordTerms(std::string_view text) const;
+    bool MatchesPositions(const ResolvedQuery& query, int document_id, ScoreAccumulator::Buffers& buffers) const;
+    static void RemoveDuplicateWords(std::vector<std::string_view>& words);
+    ResolvedQuery ResolveQuery(const Query& query) const {
+        return ResolveQuery(query, nullptr, ranking_model_);
+    }
+    // Statistics of the whole corpus replace the ones of this server, if given
+    ResolvedQuery ResolveQuery(const Query& query, const CorpusStatistics* statistics, RankingModel ranking_model) const;
+    // Fills buffers.excluded with documents of the minus words and, if there are
+    // required words, buffers.candidates with documents having all of them
+    void DecodeQueryFilters(const ResolvedQuery& query, int first_document_id, int64_t last_document_id,
+                            ScoreAccumulator::Buffers& buffers) const;
+    double ComputeWordInverseDocumentFreq(InvertedIndex::TermId term, double log_document_count) const;
+    double GetAverageWordCount() const;
+    // Parses and resolves the query without decoding its filters, for matching a single document
+    PreparedQuery ResolvePreparedQuery(std::string_view raw_query) const;
+    const ResolvedQuery& GetResolvedQuery(const PreparedQuery& query) const;
+    static uint64_t MakeServerId();
+    static int GetWorkerRangeCount();
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocumentsByStatus(ExecutionPolicy policy, std::string_view raw_query,
+                                                   DocumentStatus status, size_t top_k) const;
+    static std::string MakeResultCacheKey(const Query& query, DocumentStatus status, size_t top_k);
+
+    // End of the document id space. Ranges of ids are half-open, so the end doesn't fit int
+    static constexpr int64_t DOCUMENT_ID_END = static_cast<int64_t>(INT_MAX) + 1;
+
+    // Splits the document id space into ranges scored by independent workers.
+    // Every worker evaluates its range independently and keeps only its local top_k,
+    // so there is neither locking per posting nor a global merge of all scores
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::parallel_policy par, const Query& query, DocumentPredicate document_predicate) const {
-        ConcurrentMap<int,double> document_to_relevance(16);
-        for (const auto& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for_each(std::execution::par,word_to_document_freqs_.at(word).begin(),word_to_document_freqs_.at(word).end(),[this,&document_to_relevance,
-                                                                                                        inverse_document_freq,document_predicate]
-                                                                                                        (std::pair<int,double> id_term){
-                    const auto& document_data = this->documents_.at(id_term.first);
-                    if (document_predicate(id_term.first, document_data.status, document_data.rating)) {
-                        document_to_relevance[id_term.first].ref_to_value += id_term.second * inverse_document_freq;
-                    }
-                }
-            );
-
+    std::vector<Document> FindTopDocumentsParallel(const ResolvedQuery& query, DocumentPredicate document_predicate, size_t top_k) const {
+        if (document_ids_.empty()) {
+            return {};
         }
-        
-        for (const auto& word : query.minus_words) {
-            
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            for_each(std::execution::par,word_to_document_freqs_.at(word).begin(),word_to_document_freqs_.at(word).end(),[&document_to_relevance]
-                                                                                                                        (std::pair<int,double> id_term){
-                                                                                                                            document_to_relevance.erase(id_term.first);
-                                                                                                                        });
+        const int64_t first_document_id = *document_ids_.begin();
+        const int64_t last_document_id = static_cast<int64_t>(*document_ids_.rbegin()) + 1;
+        const int64_t range_count = std::min<int64_t>(GetWorkerRangeCount(), last_document_id - first_document_id);
+        const int64_t range_size = (last_document_id - first_document_id + range_count - 1) / range_count;
+
+        std::vector<std::vector<Document>> range_documents(range_count);
+        std::vector<int64_t> ranges(range_count);
+        for (int64_t i = 0; i < range_count; ++i) {
+            ranges[i] = i;
         }
-        auto doc_to_rel=document_to_relevance.BuildOrdinaryMap();
+        std::for_each(std::execution::par, ranges.begin(), ranges.end(), [&](int64_t range) {
+            const int64_t first = first_document_id + range * range_size;
+            const int64_t last = std::min(first + range_size, last_document_id);
+            auto& documents = range_documents[range];
+            documents = FindTopDocumentsPruned(query, document_predicate, top_k, static_cast<int>(first), last);
+        });
+
         std::vector<Document> matched_documents;
-        for (const auto [document_id, relevance] : doc_to_rel) {
-            matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+        for (const auto& documents : range_documents) {
+            matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
         }
+        SelectTopDocuments(matched_documents, top_k);
         return matched_documents;
     }
     
+    // Pruned evaluation with the scorer of the ranking model of the query
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-        std::map<int, double> document_to_relevance;
-        for (const auto& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
+    std::vector<Document> FindTopDocumentsPruned(const ResolvedQuery& query, DocumentPredicate document_predicate, size_t top_k,
+                                                 int first_document_id = 0, int64_t last_document_id = DOCUMENT_ID_END) const {
+        if (query.ranking_model == RankingModel::BM25) {
+            return FindTopDocumentsPruned(query, document_predicate, top_k, Bm25Scorer(query.average_word_count),
+                                          first_document_id, last_document_id);
+        }
+        return FindTopDocumentsPruned(query, document_predicate, top_k, TfIdfScorer(), first_document_id, last_document_id);
+    }
+
+    // Document-at-a-time MaxScore evaluation of the top_k documents with ids in
+    // [first_document_id, last_document_id). Terms are ordered by upper bounds of their scores.
+    // Once top_k documents are found, the terms whose bounds together can't reach the k-th
+    // relevance become non-essential: they are only probed for documents of the other terms,
+    // and probing stops as soon as a document can't reach the k-th relevance.
+    // A document is dropped only if it is RELEVANCE_EPSILON below the k-th relevance,
+    // so the result is the same as of the exhaustive evaluation
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocumentsPruned(const ResolvedQuery& query, DocumentPredicate document_predicate, size_t top_k,
+                                                 const Scorer& scorer, int first_document_id, int64_t last_document_id) const {
+        if (query.matches_nothing || top_k == 0) {
+            return {};
+        }
+        ScoreAccumulator::Lease lease;
+        auto& buffers = lease->buffers;
+        if (!query.has_decoded_filters) {
+            DecodeQueryFilters(query, first_document_id, last_document_id, buffers);
+        }
+        const auto& excluded = query.has_decoded_filters ? query.excluded_documents : buffers.excluded;
+        const auto& candidates = query.has_decoded_filters ? query.candidate_documents : buffers.candidates;
+        const bool has_required_terms = !query.required_terms.empty();
+        const bool has_position_constraints = !query.phrases.empty() || !query.proximities.empty();
+
+        using Cursor = ScoreAccumulator::Buffers::TermCursor;
+        auto& cursors = buffers.cursors;
+        cursors.clear();
+        for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+            const auto [term, inverse_document_freq] = query.plus_terms[i];
+            const auto& postings = index_.GetPostings(term);
+            cursors.push_back({postings.LowerBound(first_document_id), postings.end(), i, inverse_document_freq,
+                               scorer.GetUpperBound(index_.GetStatistics(term), inverse_document_freq)});
+        }
+        // Ties keep the query order, like a stable sort without its temporary buffer
+        std::sort(cursors.begin(), cursors.end(), [](const Cursor& lhs, const Cursor& rhs) {
+            return lhs.upper_bound < rhs.upper_bound || (lhs.upper_bound == rhs.upper_bound && lhs.order < rhs.order);
+        });
+        // Bound of a document found only by the cursors [0, i)
+        auto& bound_sums = buffers.bound_sums;
+        bound_sums.assign(cursors.size() + 1, 0.0);
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            bound_sums[i + 1] = bound_sums[i] + cursors[i].upper_bound;
+        }
+
+        auto& top_relevances = buffers.top_relevances;  // min-heap of the best relevances
+        top_relevances.clear();
+        double threshold = std::numeric_limits<double>::lowest();
+        size_t essential_begin = 0;
+        size_t excluded_position = 0;
+        size_t candidate_position = 0;
+        auto& term_scores = buffers.term_scores;
+        auto& matched_documents = buffers.matched_documents;
+        matched_documents.clear();
+        while (essential_begin < cursors.size()) {
+            int64_t next_document_id = last_document_id;
+            for (size_t i = essential_begin; i < cursors.size(); ++i) {
+                if (cursors[i].it != cursors[i].end) {
+                    next_document_id = std::min<int64_t>(next_document_id, cursors[i].it->document_id);
+                }
+            }
+            if (next_document_id >= last_document_id) {
+                break;
+            }
+            const int document_id = static_cast<int>(next_document_id);
+
+            excluded_position = SeekSortedId(excluded, excluded_position, document_id);
+            bool is_allowed = excluded_position == excluded.size() || excluded[excluded_position] != document_id;
+            if (is_allowed && has_required_terms) {
+                candidate_position = SeekSortedId(candidates, candidate_position, document_id);
+                is_allowed = candidate_position < candidates.size() && candidates[candidate_position] == document_id;
+            }
+            if (is_allowed) {
+                if constexpr (std::is_same_v<DocumentPredicate, StatusFilter>) {
+                    is_allowed = documents_.HasStatus(document_id, document_predicate.status);
+                } else {
+                    is_allowed = document_predicate(document_id, documents_.GetStatus(document_id), documents_.GetRating(document_id));
+                }
+            }
+            if (is_allowed && has_position_constraints) {
+                is_allowed = MatchesPositions(query, document_id, buffers);
+            }
+            const double document_norm = is_allowed ? scorer.GetDocumentNorm(documents_, document_id) : 0.0;
+
+            term_scores.clear();
+            double relevance = 0.0;
+            for (size_t i = essential_begin; i < cursors.size(); ++i) {
+                auto& cursor = cursors[i];
+                if (cursor.it != cursor.end && cursor.it->document_id == document_id) {
+                    if (is_allowed) {
+                        const double score = scorer.GetTermFreq(cursor.it->count, document_norm) * cursor.inverse_document_freq;
+                        term_scores.emplace_back(cursor.order, score);
+                        relevance += score;
+                    }
+                    ++cursor.it;
+                }
+            }
+            if (!is_allowed) {
                 continue;
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+            bool is_pruned = false;
+            for (size_t i = essential_begin; i-- > 0;) {
+                if (relevance + bound_sums[i + 1] < threshold - RELEVANCE_EPSILON) {
+                    is_pruned = true;
+                    break;
+                }
+                auto& cursor = cursors[i];
+                cursor.it.Seek(document_id);
+                if (cursor.it != cursor.end && cursor.it->document_id == document_id) {
+                    const double score = scorer.GetTermFreq(cursor.it->count, document_norm) * cursor.inverse_document_freq;
+                    term_scores.emplace_back(cursor.order, score);
+                    relevance += score;
                 }
             }
-        }    
-        for (const auto& word : query.minus_words) {
-            
-            if (word_to_document_freqs_.count(word) == 0) {
+            if (is_pruned) {
                 continue;
             }
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+
+            // Summed in the query order like in the exhaustive evaluation, so relevances are equal bitwise
+            std::sort(term_scores.begin(), term_scores.end());
+            relevance = 0.0;
+            for (const auto& [order, score] : term_scores) {
+                relevance += score;
+            }
+            matched_documents.push_back({document_id, relevance, documents_.GetRating(document_id)});
+
+            if (top_relevances.size() < top_k) {
+                top_relevances.push_back(relevance);
+                std::push_heap(top_relevances.begin(), top_relevances.end(), std::greater<>());
+            } else if (relevance > top_relevances.front()) {
+                std::pop_heap(top_relevances.begin(), top_relevances.end(), std::greater<>());
+                top_relevances.back() = relevance;
+                std::push_heap(top_relevances.begin(), top_relevances.end(), std::greater<>());
+            }
+            if (top_relevances.size() == top_k) {
+                threshold = top_relevances.front();
+                while (essential_begin < cursors.size() && bound_sums[essential_begin + 1] < threshold - RELEVANCE_EPSILON) {
+                    ++essential_begin;
+                }
             }
         }
-        std::vector<Document> matched_documents;
-        for (const auto [document_id, relevance] : document_to_relevance) {
-            matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
-        }
-        return matched_documents;
+        SelectTopDocuments(matched_documents, top_k);
+        return {matched_documents.begin(), matched_documents.end()};
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,74 @@
+#include "sharded_search_server.h"
+#include "parallel_for.h"
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const string& stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text))
+{
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if (document_id < 0) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    vector<vector<RawDocument>> shard_documents(shards_.size());
+    for (const auto& document : documents) {
+        if (document.id < 0) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+        shard_documents[document.id % shards_.size()].push_back(document);
+    }
+    ForEachIndexParallel(shards_.size(), [&](size_t shard) {
+        shards_[shard].AddDocuments(shard_documents[shard]);
+    });
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id >= 0) {
+        GetShard(document_id).RemoveDocument(document_id);
+    }
+}
+
+void ShardedSearchServer::SetRankingModel(RankingModel model) {
+    ranking_model_ = model;
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsInShards(raw_query, status, top_k);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    if (document_id < 0) {
+        throw out_of_range("Invalid document_id"s);
+    }
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const auto& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    return shards_[document_id % shards_.size()];
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return shards_[document_id % shards_.size()];
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <execution>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Search server partitioned by document id into independent shards.
+// Documents are routed to the shard owning their id, queries are scattered
+// to all shards in parallel and the per-shard top lists are merged.
+// Relevances are computed with IDF of the whole corpus, so results are
+// the same as of a single server holding all documents
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer& stop_words) {
+        if (shard_count == 0) {
+            throw std::invalid_argument("Shard count must be positive"s);
+        }
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.emplace_back(stop_words);
+        }
+    }
+
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words_text);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Shards index their parts of the batch in parallel.
+    // A shard rejecting its part doesn't roll back the other shards
+    void AddDocuments(const std::vector<RawDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // TF-IDF unless changed. Queries pass it to the shards, so a change doesn't touch them
+    void SetRankingModel(RankingModel model);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsInShards(raw_query, document_predicate, top_k);
+    }
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    std::vector<SearchServer> shards_;
+    RankingModel ranking_model_ = RankingModel::TF_IDF;
+
+    // The filter is a predicate or a status, which the shards check with their status bitmaps
+    template <typename DocumentFilter>
+    std::vector<Document> FindTopDocumentsInShards(std::string_view raw_query, DocumentFilter document_filter, size_t top_k) const {
+        CorpusStatistics statistics;
+        for (const auto& shard : shards_) {
+            shard.CollectStatistics(raw_query, statistics);
+        }
+
+        std::vector<std::vector<Document>> shard_documents(shards_.size());
+        std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_documents.begin(),
+            [&](const SearchServer& shard) {
+                return shard.FindTopDocuments(raw_query, document_filter, top_k, statistics, ranking_model_);
+            });
+
+        std::vector<Document> matched_documents;
+        for (const auto& documents : shard_documents) {
+            matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+        }
+        SelectTopDocuments(matched_documents, top_k);
+        return matched_documents;
+    }
+
+    const SearchServer& GetShard(int document_id) const;
+    SearchServer& GetShard(int document_id);
+};
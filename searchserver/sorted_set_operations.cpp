@@ -0,0 +1,24 @@
+#include "sorted_set_operations.h"
+
+#include <iterator>
+
+using namespace std;
+
+void IntersectSortedIds(const vector<int>& a, const vector<int>& b, vector<int>& result) {
+    result.clear();
+    ForEachCommonId(a.data(), a.size(), b.data(), b.size(), [&](size_t i) {
+        result.push_back(a[i]);
+    });
+}
+
+void SubtractSortedIds(const vector<int>& a, const vector<int>& b, vector<int>& result) {
+    result.clear();
+    ForEachMissingId(a.data(), a.size(), b.data(), b.size(), [&](size_t i) {
+        result.push_back(a[i]);
+    });
+}
+
+void UniteSortedIds(const vector<int>& a, const vector<int>& b, vector<int>& result) {
+    result.clear();
+    set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(result));
+}
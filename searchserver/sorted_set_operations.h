@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Set operations over ascending arrays of unique document ids.
+// Arrays of similar size are compared in blocks of 4 x 4 with SSE2
+// (a plain merge when SSE2 isn't available), a short array against
+// a long one is processed with galloping search.
+// Callbacks get positions in the first array, so parallel arrays
+// (e.g. term counts) can be read alongside
+
+// Sizes differing more than this many times switch the algorithm to galloping
+const size_t GALLOP_RATIO = 32;
+
+namespace detail {
+
+// First position not less than value, starting from position
+inline size_t Gallop(const int* data, size_t size, size_t position, int value) {
+    size_t step = 1;
+    size_t high = position;
+    while (high < size && data[high] < value) {
+        position = high + 1;
+        high += step;
+        step *= 2;
+    }
+    return std::lower_bound(data + position, data + std::min(high, size), value) - data;
+}
+
+// Calls found(i, is_common) for every a[i] in increasing order
+template <typename Callback>
+void Merge(const int* a, size_t a_size, const int* b, size_t b_size, Callback found) {
+    size_t i = 0;
+    size_t j = 0;
+
+    if (a_size * GALLOP_RATIO < b_size) {
+        for (; i < a_size; ++i) {
+            j = Gallop(b, b_size, j, a[i]);
+            found(i, j < b_size && b[j] == a[i]);
+        }
+        return;
+    }
+
+#ifdef __SSE2__
+    int a_mask = 0;  // elements of the current a-block found in the previous b-blocks
+    while (i + 4 <= a_size && j + 4 <= b_size) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i equal = _mm_cmpeq_epi32(va, vb);
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        a_mask |= _mm_movemask_ps(_mm_castsi128_ps(equal));
+
+        const int a_max = a[i + 3];
+        const int b_max = b[j + 3];
+        if (a_max <= b_max) {
+            for (int k = 0; k < 4; ++k) {
+                found(i + k, (a_mask >> k) & 1);
+            }
+            i += 4;
+            a_mask = 0;
+        }
+        if (b_max <= a_max) {
+            j += 4;
+        }
+    }
+    // Elements of an unfinished a-block may already be matched by passed b-blocks
+    const size_t block_begin = i;
+    for (; i < a_size; ++i) {
+        while (j < b_size && b[j] < a[i]) {
+            ++j;
+        }
+        const bool matched = i - block_begin < 4 && ((a_mask >> (i - block_begin)) & 1);
+        found(i, matched || (j < b_size && b[j] == a[i]));
+    }
+#else
+    for (; i < a_size; ++i) {
+        while (j < b_size && b[j] < a[i]) {
+            ++j;
+        }
+        found(i, j < b_size && b[j] == a[i]);
+    }
+#endif
+}
+
+}  // namespace detail
+
+// First position not less than value, searching forward from position
+inline size_t SeekSortedId(const std::vector<int>& ids, size_t position, int value) {
+    return detail::Gallop(ids.data(), ids.size(), position, value);
+}
+
+// Calls callback(i) for every a[i] that is also in b
+template <typename Callback>
+void ForEachCommonId(const int* a, size_t a_size, const int* b, size_t b_size, Callback callback) {
+    if (b_size * GALLOP_RATIO < a_size) {
+        // Walk the short array, galloping through the long one
+        size_t i = 0;
+        for (size_t j = 0; j < b_size && i < a_size; ++j) {
+            i = detail::Gallop(a, a_size, i, b[j]);
+            if (i < a_size && a[i] == b[j]) {
+                callback(i);
+            }
+        }
+        return;
+    }
+    detail::Merge(a, a_size, b, b_size, [&callback](size_t i, bool is_common) {
+        if (is_common) {
+            callback(i);
+        }
+    });
+}
+
+// Calls callback(i) for every a[i] that is not in b
+template <typename Callback>
+void ForEachMissingId(const int* a, size_t a_size, const int* b, size_t b_size, Callback callback) {
+    if (b_size == 0) {
+        for (size_t i = 0; i < a_size; ++i) {
+            callback(i);
+        }
+        return;
+    }
+    detail::Merge(a, a_size, b, b_size, [&callback](size_t i, bool is_common) {
+        if (!is_common) {
+            callback(i);
+        }
+    });
+}
+
+// The functions below overwrite result, it must not alias the arguments
+void IntersectSortedIds(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& result);
+
+void SubtractSortedIds(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& result);
+
+void UniteSortedIds(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& result);
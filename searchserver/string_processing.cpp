@@ -6,36 +6,43 @@ using namespace std;
 
 vector<string> SplitIntoWords(const string& text) {
     vector<string> words;
-    string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
-            }
-        } else {
-            word += c;
+    ForEachWordView(text, [&words](string_view word) {
+        if (!word.empty()) {
+            words.emplace_back(word);
         }
-    }
-    if (!word.empty()) {
-        words.push_back(word);
-    }
+    });
     return words;
 }
 
 vector<string_view> SplitIntoWordsView(string_view str) {
     vector<string_view> result;
-    const int64_t pos_end = str.npos;
-    while (true) {
-        int64_t space = str.find(' ');
-        result.push_back(str.substr(0, space));
-        if (space == pos_end) {
-            break;
-        }
-        else {
-            ++space;
-            str.remove_prefix(space);
+    ForEachWordView(str, [&result](string_view word) {
+        result.push_back(word);
+    });
+    return result;
+}
+
+bool HasControlCharacters(string_view text) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t i = 0;
+#ifdef __SSE2__
+    // Signed comparison: bytes from 0 to 31 are above -1 and below 32, non-ASCII bytes are negative
+    const __m128i lower = _mm_set1_epi8(-1);
+    const __m128i upper = _mm_set1_epi8(' ');
+    __m128i found = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        found = _mm_or_si128(found, _mm_and_si128(_mm_cmpgt_epi8(chunk, lower), _mm_cmplt_epi8(chunk, upper)));
+    }
+    if (_mm_movemask_epi8(found) != 0) {
+        return true;
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] >= '\0' && data[i] < ' ') {
+            return true;
         }
     }
-    return result;
-}
\ No newline at end of file
+    return false;
+}
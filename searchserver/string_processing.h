@@ -2,14 +2,51 @@
 
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 std::vector<std::string> SplitIntoWords(const std::string& text);
 std::vector<std::string_view> SplitIntoWordsView(std::string_view str);
 
+// Calls callback(word) for every part of the text between spaces, empty parts included.
+// Spaces are searched 16 bytes at a time with SSE2 (byte by byte when SSE2 isn't available)
+template <typename Callback>
+void ForEachWordView(std::string_view text, Callback callback) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t word_begin = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i spaces = _mm_set1_epi8(' ');
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        for (unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)); mask != 0; mask &= mask - 1) {
+            const size_t space = i + __builtin_ctz(mask);
+            callback(std::string_view(data + word_begin, space - word_begin));
+            word_begin = space + 1;
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] == ' ') {
+            callback(std::string_view(data + word_begin, i - word_begin));
+            word_begin = i + 1;
+        }
+    }
+    callback(std::string_view(data + word_begin, size - word_begin));
+}
+
+// Checks for characters with codes from 0 to 31, 16 bytes at a time with SSE2
+bool HasControlCharacters(std::string_view text);
+
+// The set compares transparently, so it can be searched by std::string_view
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string& str : strings) {
         if (!str.empty()) {
             non_empty_strings.insert(str);
@@ -0,0 +1,263 @@
+#include "test_example_functions.h"
+
+#include "search_server.h"
+#include "sorted_set_operations.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <execution>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void TestSearchServer() {
+    TestMaxDocumentId();
+    TestPrunedTopDocuments();
+    TestSortedSetOperations();
+    TestIndexFile();
+}
+
+void TestMaxDocumentId() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(INT_MAX, "white cat", DocumentStatus::ACTUAL, {1});
+
+    const auto check = [](const vector<Document>& documents) {
+        assert(documents.size() == 1);
+        assert(documents[0].id == INT_MAX);
+    };
+    check(search_server.FindTopDocuments("cat"));
+    check(search_server.FindTopDocuments(execution::seq, "cat"));
+    check(search_server.FindTopDocuments(execution::par, "cat"));
+    check(search_server.FindTopDocuments("+white cat"));
+    check(search_server.FindTopDocuments(execution::par, "+white cat"));
+    assert(search_server.FindTopDocuments("cat -white").empty());
+    assert(search_server.FindTopDocuments(execution::par, "cat -white").empty());
+
+    check(search_server.FindTopDocuments(search_server.PrepareQuery("+white cat")));
+    assert(search_server.FindTopDocuments(search_server.PrepareQuery("cat -white")).empty());
+
+    const auto batch = search_server.FindTopDocumentsBatch({"cat"s, "+white cat"s, "cat -white"s});
+    check(batch[0]);
+    check(batch[1]);
+    assert(batch[2].empty());
+
+    search_server.AddDocument(0, "black cat", DocumentStatus::ACTUAL, {1});
+    const auto documents = search_server.FindTopDocuments(execution::par, "white");
+    assert(documents.size() == 1 && documents[0].id == INT_MAX);
+}
+
+void TestPrunedTopDocuments() {
+    // Frequencies of the words differ a lot, so the rare words bound the scores of the frequent ones
+    mt19937 generator(42);
+    SearchServer search_server("w0"s);
+    for (int document_id = 0; document_id < 3000; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(1, 12)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            const int max_word = uniform_int_distribution(0, 39)(generator);
+            text += "w"s + to_string(uniform_int_distribution(0, max_word)(generator)) + " "s;
+        }
+        text.pop_back();
+        search_server.AddDocument(document_id, text, document_id % 10 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                                  {document_id % 7});
+    }
+
+    const auto find_exhaustive = [&search_server](const vector<string>& plus_words, const string& minus_word, size_t top_k) {
+        vector<Document> documents;
+        for (const int document_id : search_server) {
+            if (document_id % 10 == 0) {
+                continue;
+            }
+            const auto word_freqs = search_server.GetWordFrequencies(document_id);
+            if (!minus_word.empty() && word_freqs.count(minus_word) > 0) {
+                continue;
+            }
+            double relevance = 0.0;
+            bool matched = false;
+            for (const auto [word, term_freq] : word_freqs) {
+                if (find(plus_words.begin(), plus_words.end(), word) != plus_words.end()) {
+                    relevance += term_freq * log(search_server.GetDocumentCount() * 1.0 / search_server.GetDocumentFrequency(word));
+                    matched = true;
+                }
+            }
+            if (matched) {
+                documents.push_back({document_id, relevance, document_id % 7});
+            }
+        }
+        SelectTopDocuments(documents, top_k);
+        return documents;
+    };
+    const auto check = [](const vector<Document>& documents, const vector<Document>& expected) {
+        assert(documents.size() == expected.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            assert(documents[i].id == expected[i].id);
+            assert(abs(documents[i].relevance - expected[i].relevance) < RELEVANCE_EPSILON);
+        }
+    };
+
+    for (int query_index = 0; query_index < 50; ++query_index) {
+        vector<string> plus_words;
+        string raw_query;
+        const int word_count = uniform_int_distribution(1, 6)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            const string word = "w"s + to_string(uniform_int_distribution(1, 39)(generator));
+            if (find(plus_words.begin(), plus_words.end(), word) == plus_words.end()) {
+                plus_words.push_back(word);
+                raw_query += word + " "s;
+            }
+        }
+        string minus_word = "w"s + to_string(uniform_int_distribution(1, 39)(generator));
+        if (find(plus_words.begin(), plus_words.end(), minus_word) == plus_words.end()) {
+            raw_query += "-"s + minus_word + " "s;
+        } else {
+            minus_word.clear();
+        }
+        raw_query.pop_back();
+        for (const size_t top_k : {1, 2, 5, 50, 5000}) {
+            const auto expected = find_exhaustive(plus_words, minus_word, top_k);
+            check(search_server.FindTopDocuments(raw_query, DocumentStatus::ACTUAL, top_k), expected);
+            check(search_server.FindTopDocuments(execution::par, raw_query, DocumentStatus::ACTUAL, top_k), expected);
+        }
+    }
+}
+
+void TestSortedSetOperations() {
+    mt19937 generator(7);
+    // Ids are drawn from a range a few times larger than the array, so the arrays overlap partly
+    const auto make_ids = [&generator](size_t size) {
+        vector<int> ids;
+        uniform_int_distribution<int> distribution(0, static_cast<int>(size) * 3);
+        while (ids.size() < size) {
+            ids.push_back(distribution(generator));
+            sort(ids.begin(), ids.end());
+            ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        }
+        return ids;
+    };
+    const auto check = [&make_ids](size_t a_size, size_t b_size) {
+        const auto a = make_ids(a_size);
+        const auto b = make_ids(b_size);
+        vector<int> result;
+        vector<int> expected;
+
+        IntersectSortedIds(a, b, result);
+        set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+        assert(result == expected);
+
+        expected.clear();
+        SubtractSortedIds(a, b, result);
+        set_difference(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+        assert(result == expected);
+
+        expected.clear();
+        UniteSortedIds(a, b, result);
+        set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+        assert(result == expected);
+    };
+
+    for (size_t a_size = 0; a_size <= 13; ++a_size) {
+        for (size_t b_size = 0; b_size <= 13; ++b_size) {
+            for (int i = 0; i < 20; ++i) {
+                check(a_size, b_size);
+            }
+        }
+    }
+    for (const size_t short_size : {1, 3, 5}) {
+        for (size_t long_size = short_size * GALLOP_RATIO - 2; long_size <= short_size * GALLOP_RATIO + 2; ++long_size) {
+            check(short_size, long_size);
+            check(long_size, short_size);
+        }
+    }
+}
+
+void TestIndexFile() {
+    const string path = "test_index.bin"s;
+    const string damaged_path = "test_index_damaged.bin"s;
+
+    SearchServer search_server("and with"s);
+    search_server.EnablePositionIndex();
+    const vector<string> texts = {
+        "white cat and fancy collar"s, "fluffy cat fluffy tail"s, "groomed dog expressive eyes"s,
+        "groomed starling eugene"s, "white dog with black spots"s, "fancy cat with white collar"s,
+    };
+    for (int document_id = 0; document_id < 60; ++document_id) {
+        search_server.AddDocument(document_id * 3, texts[document_id % texts.size()],
+                                  static_cast<DocumentStatus>(document_id % 4), {document_id, -document_id % 5});
+    }
+    search_server.RemoveDocument(30);
+    search_server.SaveIndex(path);
+
+    SearchServer opened = SearchServer::OpenIndex(path);
+    opened.VerifyIndex();
+    const auto check = [&search_server, &opened]() {
+        assert(opened.GetDocumentCount() == search_server.GetDocumentCount());
+        for (const string& query : {"cat"s, "fancy white -dog"s, "+groomed eyes"s, "\"white collar\""s, "cat NEAR/2 collar"s}) {
+            const auto expected = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 100);
+            const auto documents = opened.FindTopDocuments(query, DocumentStatus::ACTUAL, 100);
+            assert(documents.size() == expected.size());
+            for (size_t i = 0; i < documents.size(); ++i) {
+                assert(documents[i].id == expected[i].id && documents[i].rating == expected[i].rating);
+                assert(abs(documents[i].relevance - expected[i].relevance) < RELEVANCE_EPSILON);
+            }
+        }
+        for (const int document_id : search_server) {
+            const auto word_freqs = search_server.GetWordFrequencies(document_id);
+            const auto opened_word_freqs = opened.GetWordFrequencies(document_id);
+            assert((map<string_view, double>(word_freqs.begin(), word_freqs.end())
+                    == map<string_view, double>(opened_word_freqs.begin(), opened_word_freqs.end())));
+            assert(get<1>(opened.MatchDocument("cat"s, document_id)) == get<1>(search_server.MatchDocument("cat"s, document_id)));
+        }
+    };
+    check();
+    // Modifications copy the data used in place
+    for (SearchServer* server : {&search_server, &opened}) {
+        server->RemoveDocument(0);
+        server->RemoveDocument(3);
+        server->AddDocument(1000, "white cat with black collar"s, DocumentStatus::ACTUAL, {7});
+    }
+    check();
+
+    ifstream in(path, ios::binary);
+    const string data{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+    const auto open_damaged = [&damaged_path](const string& damaged_data) {
+        ofstream(damaged_path, ios::binary | ios::trunc) << damaged_data;
+        SearchServer server = SearchServer::OpenIndex(damaged_path);
+        server.VerifyIndex();
+        return server;
+    };
+    const auto is_rejected = [&open_damaged](const string& damaged_data) {
+        try {
+            open_damaged(damaged_data);
+        } catch (const exception&) {
+            return true;
+        }
+        return false;
+    };
+    assert(is_rejected(data.substr(0, data.size() / 2)));
+    assert(is_rejected(data.substr(0, 16)));
+    string wrong_version = data;
+    ++wrong_version[8];
+    assert(is_rejected(wrong_version));
+    // Any damaged byte is either rejected or leaves an index that can be searched
+    for (size_t i = 0; i < data.size(); ++i) {
+        string damaged_data = data;
+        damaged_data[i] ^= 0x5A;
+        try {
+            const SearchServer server = open_damaged(damaged_data);
+            server.FindTopDocuments("white cat"s);
+            server.FindTopDocuments("\"white collar\""s);
+        } catch (const exception&) {
+        }
+    }
+
+    remove(path.c_str());
+    remove(damaged_path.c_str());
+}
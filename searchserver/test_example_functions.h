@@ -1 +1,14 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+// Runs all the tests below, a failed check aborts the program
+void TestSearchServer();
+
+// Documents with the largest possible id are found, filtered and ranked like the others
+void TestMaxDocumentId();
+// The pruned top-K evaluation returns the same documents as scoring every document
+void TestPrunedTopDocuments();
+// Set operations over sorted ids match the scalar std:: algorithms for arrays of any length,
+// both in the SSE2 blocks and their tails and around the switch to galloping search
+void TestSortedSetOperations();
+// An index opened from a file answers like the saved one, damaged files are rejected
+void TestIndexFile();
@@ -0,0 +1,34 @@
+#include "text_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+string_view TextArena::Store(string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    if (text.size() > free_size_) {
+        // Long texts get a chunk of their own, the current chunk stays open for shorter ones
+        const size_t chunk_size = max(CHUNK_SIZE, text.size());
+        // Not value-initialized, every byte is written before it is read
+        chunks_.emplace_back(new char[chunk_size]);
+        capacity_ += chunk_size;
+        if (chunk_size > CHUNK_SIZE) {
+            memcpy(chunks_.back().get(), text.data(), text.size());
+            return {chunks_.back().get(), text.size()};
+        }
+        free_begin_ = chunks_.back().get();
+        free_size_ = chunk_size;
+    }
+    char* const stored = free_begin_;
+    memcpy(stored, text.data(), text.size());
+    free_begin_ += text.size();
+    free_size_ -= text.size();
+    return {stored, text.size()};
+}
+
+size_t TextArena::GetCapacity() const {
+    return capacity_;
+}
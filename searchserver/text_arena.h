@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Append-only storage of document texts. Texts are placed one after another
+// in large chunks, so storing a text is a copy without a separate allocation.
+// Views to the stored texts stay valid for the lifetime of the arena.
+// Memory of removed documents isn't reused
+class TextArena {
+public:
+    std::string_view Store(std::string_view text);
+
+    // Bytes taken by the chunks
+    size_t GetCapacity() const;
+
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t capacity_ = 0;
+    char* free_begin_ = nullptr;
+    size_t free_size_ = 0;
+};
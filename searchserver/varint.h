@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Little-endian base-128 varints: 7 bits per byte, the high bit marks a following byte.
+// Shared by the encoded posting lists and the position index
+
+inline void WriteVarint(std::vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+// Expects a well-formed varint
+inline uint32_t ReadVarint(const uint8_t*& data) {
+    uint32_t value = *data & 0x7F;
+    int shift = 7;
+    while (*data++ & 0x80) {
+        value |= static_cast<uint32_t>(*data & 0x7F) << shift;
+        shift += 7;
+    }
+    return value;
+}
+
+// Reads a varint not crossing end, false if it's truncated or too long
+inline bool ReadVarintChecked(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && data != end; shift += 7) {
+        const uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}